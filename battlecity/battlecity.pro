@@ -5,11 +5,19 @@ CONFIG += c++11
 HEADERS += \
 # ecs framework
         ecs/framework/entity.h \
+        ecs/framework/archetype.h \
+        ecs/framework/view.h \
+        ecs/framework/prefab.h \
+        ecs/framework/command_buffer.h \
         ecs/framework/id_engine.h \
         ecs/framework/world.h \
         ecs/framework/details/polymorph.h \
+        ecs/framework/details/lock_policy.h \
         ecs/framework/details/rw_lock.h \
         ecs/framework/details/atomic_locks.h \
+        ecs/framework/details/mpsc_ring.h \
+        ecs/framework/details/block_pool.h \
+        ecs/framework/details/thread_pool.h \
         ecs/framework/details/rw_lock_guard.h \
         ecs/framework/details/rw_lock_modes.h \
         ecs/framework/details/cpp14/make_unique.h \
@@ -17,10 +25,13 @@ HEADERS += \
 # game ecs stuff
         ecs/components.h \
         ecs/events.h \
+        ecs/resources.h \
         ecs/systems.h \
         ecs/entity_factory.h \
         ecs/general_enums.h \
         ecs/map_graph.h \
+        ecs/spatial_grid.h \
+        ecs/traversability_map.h \
 # game stuff
         map_objects/base_map_object.h \
         map_objects/graphics_map_object.h \
@@ -37,18 +48,25 @@ SOURCES += \
         main.cpp \
 # ecs framework
         ecs/framework/entity.cpp \
+        ecs/framework/archetype.cpp \
+        ecs/framework/view.cpp \
+        ecs/framework/command_buffer.cpp \
         ecs/framework/id_engine.cpp \
         ecs/framework/world.cpp \
         ecs/framework/details/polymorph.cpp \
         ecs/framework/details/polymorph.impl \
         ecs/framework/details/rw_lock.cpp \
         ecs/framework/details/atomic_locks.cpp \
+        ecs/framework/details/thread_pool.cpp \
 # game ecs stuff
         ecs/components.cpp \
         ecs/events.cpp \
         ecs/systems.cpp \
         ecs/entity_factory.cpp \
         ecs/map_graph.cpp \
+        ecs/resources.cpp \
+        ecs/spatial_grid.cpp \
+        ecs/traversability_map.cpp \
 # game stuff
         map_objects/base_map_object.cpp \
         map_objects/graphics_map_object.cpp \
@@ -62,6 +80,7 @@ SOURCES += \
 
 RESOURCES += resources.qrc
 DEFINES += "ECS_LOCK_MUTEX"
+CONFIG(release, debug|release): DEFINES += NDEBUG
 
 # Additional import path used to resolve QML modules in Qt Creator's code model
 QML_IMPORT_PATH =
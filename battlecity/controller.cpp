@@ -19,6 +19,8 @@ namespace game
 
 controller::controller( const game_settings& settings, ecs::world& world ) :
     m_world( world ),
+    m_players_view( world.view< component::player, component::lifes >() ),
+    m_player_bases_view( world.view< component::player_base, component::health >() ),
     m_settings( settings )
 {
     m_thread = new QThread{ this };
@@ -108,6 +110,12 @@ void controller::init()
     m_world.subscribe< event::entity_hit >( *this );
     m_world.subscribe< event::animation_started >( *this );
 
+    // posted from the GUI thread
+    m_world.register_input< event::move_direction_requested >();
+
+    // every moved object emits one, so they're delivered in batches after the movement
+    m_world.set_event_queued< event::geometry_changed >();
+
     m_state = controller_state::stopped;
 }
 
@@ -187,6 +195,8 @@ void controller::load_level()
     {
         system->init();
     }
+
+    publish_hud();
 }
 
 const controller_state& controller::get_state() const noexcept
@@ -236,6 +246,11 @@ void controller::set_map_mediator( map_interface* mediator ) noexcept
              mediator,
              SLOT( entities_removed( const event::entities_removed& ) ) );
 
+    connect( this,
+             SIGNAL( hud_changed_signal() ),
+             mediator,
+             SLOT( hud_changed() ) );
+
     connect( this,
              SIGNAL( prepare_to_load_next_level_signal() ),
              mediator,
@@ -297,38 +312,42 @@ const QString& controller::get_level() const noexcept
     return m_map_data.get_map_name();
 }
 
-uint32_t controller::get_player_remaining_lifes()
+uint32_t controller::get_player_remaining_lifes() const noexcept
 {
-    uint32_t lifes_num{ 0 };
+    return m_player_lifes.load( std::memory_order_relaxed );
+}
+
+uint32_t controller::get_base_remaining_health() const noexcept
+{
+    return m_base_health.load( std::memory_order_relaxed );
+}
 
-    auto players =  m_world.get_entities_with_components< component::player >();
-    if( !players.empty() )
+void controller::publish_hud()
+{
+    uint32_t lifes_num{ 0 };
+    auto player = m_players_view.begin();
+    if( player != m_players_view.end() )
     {
-        ecs::entity* player{ players.front() };
-        component::lifes& lifes = player->get_component< component::lifes >();
-        ecs::rw_lock_guard< ecs::rw_lock > l{ lifes, ecs::lock_mode::read };
+        component::lifes& lifes = player->get_component_unsafe< component::lifes >();
+        ecs::lock_guard_for< component::lifes > l{ lifes, ecs::lock_mode::read };
         lifes_num = lifes.get_lifes();
     }
 
-    return lifes_num;
-}
-
-uint32_t controller::get_base_remaining_health()
-{
     uint32_t remaining_health{ 0 };
-
-    auto player_bases =  m_world.get_entities_with_components< component::player_base >();
-    if( !player_bases.empty() )
+    auto player_base = m_player_bases_view.begin();
+    if( player_base != m_player_bases_view.end() )
     {
-        ecs::entity* player_base{ player_bases.front() };
-        component::health& health = player_base->get_component< component::health >();
-        ecs::rw_lock_guard< ecs::rw_lock > l{ health, ecs::lock_mode::read };
-
+        component::health& health = player_base->get_component_unsafe< component::health >();
+        ecs::lock_guard_for< component::health > l{ health, ecs::lock_mode::read };
         remaining_health = health.get_health();
     }
 
-    return remaining_health;
-
+    const bool lifes_changed{ m_player_lifes.exchange( lifes_num, std::memory_order_relaxed ) != lifes_num };
+    const bool health_changed{ m_base_health.exchange( remaining_health, std::memory_order_relaxed ) != remaining_health };
+    if( lifes_changed || health_changed )
+    {
+        emit hud_changed_signal();
+    }
 }
 
 void controller::on_event( const event::level_completed& event )
@@ -389,6 +408,7 @@ void controller::on_event( const event::entities_removed& event )
 void controller::tick()
 {
     m_world.tick();
+    publish_hud();
 }
 
 }// game
@@ -2,11 +2,13 @@
 #define CONTROLLER_H
 
 #include <mutex>
+#include <atomic>
 
 #include <QTimer>
 
 #include "map_data.h"
 #include "ecs/events.h"
+#include "ecs/components.h"
 #include "game_settings.h"
 
 namespace game
@@ -48,8 +50,10 @@ public:
     int get_tile_width() const noexcept;
     int get_tile_height() const noexcept;
     const QString& get_level() const noexcept;
-    uint32_t get_player_remaining_lifes();
-    uint32_t get_base_remaining_health();
+
+    // Published by the ECS thread after each tick, see hud_changed_signal()
+    uint32_t get_player_remaining_lifes() const noexcept;
+    uint32_t get_base_remaining_health() const noexcept;
 
     void on_event( const event::level_completed& event ) override;
     void on_event( const event::projectile_fired& event ) override;
@@ -68,6 +72,9 @@ public slots:
 private:
     void load_level();
 
+    // Reads the HUD counters on the ECS thread, so the GUI doesn't iterate the views while the world changes
+    void publish_hud();
+
 private slots:
     void tick();
 
@@ -80,6 +87,7 @@ signals:
     void entity_hit_signal( const event::entity_hit& );
     void entity_killed_signal( const event::entity_killed& );
     void entities_removed_signal( const event::entities_removed& );
+    void hud_changed_signal();
     void prepare_to_load_next_level_signal();
 
     //internal
@@ -88,6 +96,11 @@ signals:
 
 private:
     ecs::world& m_world;
+    // only iterated on the ECS thread, the GUI reads the published counters below
+    ecs::query_view< component::player, component::lifes >& m_players_view;
+    ecs::query_view< component::player_base, component::health >& m_player_bases_view;
+    std::atomic< uint32_t > m_player_lifes{ 0 };
+    std::atomic< uint32_t > m_base_health{ 0 };
     map_data m_map_data;
     game_settings m_settings;
     map_interface* m_mediator{ nullptr };
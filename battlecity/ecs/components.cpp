@@ -1,34 +1,92 @@
 #include "components.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace game
 {
 
 namespace component
 {
 
+constexpr size_t positioning::max_nodes;
+
 positioning::positioning( map_tile_node& initial_node )
 {
-    m_nodes.emplace( &initial_node );
+    add_node( initial_node );
 }
 
 void positioning::add_node( map_tile_node& node )
 {
-    m_nodes.emplace( &node );
+    if( std::find( begin(), end(), &node ) != end() )
+    {
+        return;
+    }
+
+    if( m_nodes_count == max_nodes )
+    {
+        throw std::length_error{ "Object can't overlap more tiles" };
+    }
+
+    m_nodes[ m_nodes_count++ ] = &node;
+    m_graph = &node.get_graph();
+}
+
+void positioning::remove_node( const map_tile_node& node ) noexcept
+{
+    auto it = std::find( m_nodes.begin(), m_nodes.begin() + m_nodes_count, &node );
+    if( it != m_nodes.begin() + m_nodes_count )
+    {
+        *it = m_nodes[ --m_nodes_count ];
+        m_nodes[ m_nodes_count ] = nullptr;
+    }
+}
+
+void positioning::clear_nodes() noexcept
+{
+    m_nodes.fill( nullptr );
+    m_nodes_count = 0;
+}
+
+void positioning::set_nodes_in( const QRect& rect )
+{
+    if( !m_graph )
+    {
+        return;
+    }
+
+    clear_nodes();
+
+    m_graph->for_each_node_in( rect, [ this ]( map_tile_node& node )
+    {
+        add_node( node );
+        return true;
+    } );
+}
+
+bool positioning::has_nodes() const noexcept
+{
+    return m_nodes_count != 0;
 }
 
-void positioning::remove_node( map_tile_node& node )
+size_t positioning::get_nodes_count() const noexcept
 {
-    m_nodes.erase( &node );
+    return m_nodes_count;
 }
 
-std::unordered_set< map_tile_node* >& positioning::get_nodes() noexcept
+map_graph* positioning::get_graph() const noexcept
 {
-    return m_nodes;
+    return m_graph;
 }
 
-const std::unordered_set< map_tile_node* >& positioning::get_nodes() const noexcept
+positioning::iterator positioning::begin() const noexcept
 {
-    return m_nodes;
+    return m_nodes.data();
+}
+
+positioning::iterator positioning::end() const noexcept
+{
+    return m_nodes.data() + m_nodes_count;
 }
 
 //
@@ -157,6 +215,16 @@ void projectile::set_destroyed() noexcept
     m_is_destroyed = true;
 }
 
+void projectile::set_impact_node( map_tile_node* node ) noexcept
+{
+    m_impact_node = node;
+}
+
+map_tile_node* projectile::get_impact_node() const noexcept
+{
+    return m_impact_node;
+}
+
 uint32_t projectile::get_damage() const noexcept
 {
     return m_damage;
@@ -3,7 +3,7 @@
 
 #include <map>
 #include <list>
-#include <unordered_set>
+#include <array>
 
 #include <QRect>
 #include <QString>
@@ -18,20 +18,36 @@ namespace game
 namespace component
 {
 
+// Tiles the object overlaps. Objects are never bigger than a tile, so there are 4 of them at most
 class positioning final
 {
 public:
+    static constexpr size_t max_nodes{ 4 };
+    using iterator = map_tile_node* const*;
+
     positioning() = default;
     explicit positioning( map_tile_node& initial_node );
 
-
+    // Throws std::length_error if there are max_nodes nodes already
     void add_node( map_tile_node& node );
-    void remove_node( map_tile_node& node );
-    std::unordered_set< map_tile_node* >& get_nodes() noexcept;
-    const std::unordered_set< map_tile_node* >& get_nodes() const noexcept;
+    void remove_node( const map_tile_node& node ) noexcept;
+    void clear_nodes() noexcept;
+
+    // Replaces the nodes with the ones the rect overlaps in the graph of the nodes added before.
+    // Throws std::length_error if the rect is too big
+    void set_nodes_in( const QRect& rect );
+
+    bool has_nodes() const noexcept;
+    size_t get_nodes_count() const noexcept;
+    map_graph* get_graph() const noexcept; // nullptr until a node is added
+
+    iterator begin() const noexcept;
+    iterator end() const noexcept;
 
 private:
-    std::unordered_set< map_tile_node* > m_nodes;
+    std::array< map_tile_node*, max_nodes > m_nodes{ {} };
+    size_t m_nodes_count{ 0 };
+    map_graph* m_graph{ nullptr };
 };
 
 //
@@ -51,7 +67,7 @@ private:
 
 //
 
-class turret_object final : public ecs::rw_lock
+class turret_object final : public ecs::use_lock< ecs::spinlock >
 {
     using clock = std::chrono::high_resolution_clock;
 
@@ -161,6 +177,10 @@ public:
     void set_damage( uint32_t damage ) noexcept;
     void set_destroyed() noexcept;
 
+    // First non traversible tile on the way, nullptr if the projectile leaves the map
+    void set_impact_node( map_tile_node* node ) noexcept;
+    map_tile_node* get_impact_node() const noexcept;
+
     uint32_t get_damage() const noexcept;
     bool get_destroyed() const noexcept;
     ecs::entity_id get_shooter_id() const noexcept;
@@ -170,12 +190,13 @@ private:
     uint32_t m_damage{ 1 };
     ecs::entity_id m_shooter_id{ INVALID_NUMERIC_ID };
     object_type m_shooter_type;
+    map_tile_node* m_impact_node{ nullptr };
     bool m_is_destroyed{ false };
 };
 
 //
 
-class geometry final : public ecs::rw_lock
+class geometry final : public ecs::use_lock< ecs::rw_spinlock >
 {
 public:
     geometry() = default;
@@ -205,7 +226,7 @@ private:
 
 //
 
-class movement final : public ecs::rw_lock
+class movement final : public ecs::use_lock< ecs::rw_spinlock >
 {
 public:
     movement() = default;
@@ -229,7 +250,7 @@ class flying final{}; // can pass through non_traversible
 
 //
 
-class graphics final : public ecs::rw_lock
+class graphics final : public ecs::use_lock< ecs::rw_spinlock >
 {
 public:
     graphics() = default;
@@ -284,7 +305,7 @@ private:
 
 //
 
-class health final : public ecs::rw_lock
+class health final : public ecs::use_lock< ecs::spinlock >
 {
 public:
     health() = default;
@@ -303,7 +324,7 @@ private:
     const uint32_t m_max_health{ 0 };
 };
 
-class lifes final : public ecs::rw_lock
+class lifes final : public ecs::use_lock< ecs::spinlock >
 {
 public:
     lifes() = default;
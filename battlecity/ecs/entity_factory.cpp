@@ -1,5 +1,6 @@
 #include "entity_factory.h"
 
+#include "resources.h"
 #include "components.h"
 
 static constexpr auto image_tile_empty = "tile_empty";
@@ -18,6 +19,56 @@ static constexpr auto image_shield_animation = "shield_animation";
 namespace game
 {
 
+// Projectiles and animations are created and removed all the time, so they are recycled
+using projectile_prefab = ecs::prefab< component::projectile,
+                                       component::geometry,
+                                       component::flying,
+                                       component::movement,
+                                       component::graphics,
+                                       component::positioning >;
+
+using animation_prefab = ecs::prefab< component::animation,
+                                      component::animation_info,
+                                      component::geometry,
+                                      component::graphics >;
+
+// The rest is only created on level load, so it's instantiated at once without any pooling
+using empty_tile_prefab = ecs::prefab< component::geometry,
+                                       component::tile_object,
+                                       component::graphics >;
+
+using wall_tile_prefab = ecs::prefab< component::geometry,
+                                      component::tile_object,
+                                      component::graphics,
+                                      component::non_traversible_tile,
+                                      component::health >;
+
+using player_tank_prefab = ecs::prefab< component::tank_object,
+                                        component::geometry,
+                                        component::health,
+                                        component::movement,
+                                        component::kills_counter,
+                                        component::powerup_animations,
+                                        component::graphics,
+                                        component::respawn_delay,
+                                        component::turret_object,
+                                        component::player,
+                                        component::non_traversible_object,
+                                        component::lifes >;
+
+using enemy_tank_prefab = ecs::prefab< component::tank_object,
+                                       component::geometry,
+                                       component::health,
+                                       component::movement,
+                                       component::kills_counter,
+                                       component::powerup_animations,
+                                       component::graphics,
+                                       component::respawn_delay,
+                                       component::turret_object,
+                                       component::enemy,
+                                       component::lifes,
+                                       component::positioning >;
+
 QString get_image_path( const QString& image_name )
 {
     return QString( "qrc:/graphics/%1.png" ).arg( image_name );
@@ -74,6 +125,8 @@ ecs::entity& create_map_entity(const QRect& rect, ecs::world& world )
     entity.add_component< component::game_map >();
     entity.add_component< component::geometry >( rect );
 
+    world.set_resource< resource::map_geometry >( rect );
+
     return entity;
 }
 
@@ -87,88 +140,88 @@ ecs::entity& create_entity_player_base( const QRect& rect, uint32_t health, ecs:
     entity.add_component< component::non_traversible_object >();
     entity.add_component< component::graphics >( get_image_path( image_player_base ) );
 
+    world.set_resource< resource::player_base >( entity );
+
     return entity;
 }
 
 ecs::entity& create_entity_tile( const tile_type& type, const QRect& rect, uint32_t health, ecs::world& world )
 {
-    ecs::entity& entity = world.create_entity();
-
-    try
+    if( tile_traversible( type ) )
     {
-        entity.add_component< component::geometry >( rect );
-        entity.add_component< component::tile_object >( type );
-        entity.add_component< component::graphics >( tile_image_path( type ) );
-
-        if( !tile_traversible( type ) )
-        {
-            entity.add_component< component::non_traversible_tile >();
-            entity.add_component< component::health >( health );
-        }
-    }
-    catch( ... )
-    {
-        world.remove_entity( entity );
-        throw;
+        return world.instantiate< empty_tile_prefab >( std::forward_as_tuple( rect ),
+                                                       std::forward_as_tuple( type ),
+                                                       std::forward_as_tuple( tile_image_path( type ) ) );
     }
 
-    return entity;
+    return world.instantiate< wall_tile_prefab >( std::forward_as_tuple( rect ),
+                                                  std::forward_as_tuple( type ),
+                                                  std::forward_as_tuple( tile_image_path( type ) ),
+                                                  std::make_tuple(),
+                                                  std::forward_as_tuple( health ) );
 }
 
 ecs::entity& create_entity_tank( const tank_entity_params& params, ecs::world& world )
 {
-    using namespace component;
-
-    ecs::entity& entity = world.create_entity();
-
-    try
+    if( params.align == alignment::player )
     {
-        entity.add_component< tank_object >();
-        entity.add_component< geometry >( params.rect );
-        entity.add_component< component::health >( params.health );
-        entity.add_component< movement >( params.speed );
-        entity.add_component< kills_counter >();
-        entity.add_component< powerup_animations >();
-        entity.add_component< graphics >( tank_image_path( params.align ) );
-        entity.add_component< component::respawn_delay >( params.respawn_delay );
-        entity.add_component< turret_object >( params.turret_cooldown_msec );
-
-        if( params.align == alignment::player )
-        {
-            entity.add_component< player >();
-            entity.add_component< non_traversible_object >();
-            entity.add_component< component::lifes >( has_infinite_lifes::no, params.lifes );
-        }
-        else
-        {
-            entity.add_component< enemy >();
-            entity.add_component< component::lifes >( has_infinite_lifes::yes );
-        }
+        ecs::entity& entity = world.instantiate< player_tank_prefab >(
+                    std::make_tuple(),
+                    std::forward_as_tuple( params.rect ),
+                    std::forward_as_tuple( params.health ),
+                    std::forward_as_tuple( params.speed ),
+                    std::make_tuple(),
+                    std::make_tuple(),
+                    std::forward_as_tuple( tank_image_path( params.align ) ),
+                    std::forward_as_tuple( params.respawn_delay ),
+                    std::forward_as_tuple( params.turret_cooldown_msec ),
+                    std::make_tuple(),
+                    std::make_tuple(),
+                    std::forward_as_tuple( has_infinite_lifes::no, params.lifes ) );
+
+        world.set_resource< resource::player >( entity );
+        return entity;
     }
-    catch( ... )
+
+    return *create_enemy_tanks( params, 1, world ).front();
+}
+
+std::vector< ecs::entity* > create_enemy_tanks( const tank_entity_params& params, size_t count, ecs::world& world )
+{
+    if( params.align != alignment::enemy )
     {
-        world.remove_entity( entity );
-        throw;
+        throw std::invalid_argument{ "Only enemy tanks can be created in batches" };
     }
 
-    return entity;
+    return world.create_entities< enemy_tank_prefab >(
+                count,
+                std::make_tuple(),
+                std::make_tuple( params.rect ),
+                std::make_tuple( params.health ),
+                std::make_tuple( params.speed ),
+                std::make_tuple(),
+                std::make_tuple(),
+                std::make_tuple( tank_image_path( params.align ) ),
+                std::make_tuple( params.respawn_delay ),
+                std::make_tuple( params.turret_cooldown_msec ),
+                std::make_tuple(),
+                std::make_tuple( has_infinite_lifes::yes ),
+                std::make_tuple() );
 }
 
 ecs::entity& create_entity_projectile( const projectile_params& params, ecs::world& world )
 {
     using namespace component;
-    ecs::entity& entity = world.create_entity();
-
-    entity.add_component< projectile >( params.damage, params.owner );
-    entity.add_component< geometry >( params.rect );
-    entity.add_component< flying >();
-    entity.add_component< movement >( params.speed, params.direction );
-    entity.add_component< graphics >( get_image_path( image_projectile ) );
-    entity.add_component< positioning >();
+    ecs::entity& entity = world.recycle_or_create< projectile_prefab >(
+                std::forward_as_tuple( params.damage, params.owner ),
+                std::forward_as_tuple( params.rect ),
+                std::make_tuple(),
+                std::forward_as_tuple( params.speed, params.direction ),
+                std::forward_as_tuple( get_image_path( image_projectile ) ),
+                std::make_tuple() );
 
     positioning& p = entity.get_component< positioning >();
-    auto& nodes = params.owner.get_component< positioning >().get_nodes();
-    for( map_tile_node* node : nodes )
+    for( map_tile_node* node : params.owner.get_component< positioning >() )
     {
         if( node->get_rect().intersects( params.rect ) )
         {
@@ -223,17 +276,11 @@ ecs::entity& create_animation( const QRect& rect,
                                const animation_type& type,
                                ecs::world& world )
 {
-    ecs::entity& entity = world.create_entity();
-
-    entity.add_component< component::animation >();
-    entity.add_component< component::animation_info >( type,
-                                                       data.frame_num,
-                                                       data.frame_rate,
-                                                       data.loops,
-                                                       data.duration );
-
-    entity.add_component< component::geometry >( rect );
-    entity.add_component< component::graphics >( get_animation_path( type ) );
+    ecs::entity& entity = world.recycle_or_create< animation_prefab >(
+                std::make_tuple(),
+                std::forward_as_tuple( type, data.frame_num, data.frame_rate, data.loops, data.duration ),
+                std::forward_as_tuple( rect ),
+                std::forward_as_tuple( get_animation_path( type ) ) );
 
     return entity;
 }
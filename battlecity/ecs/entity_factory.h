@@ -50,6 +50,9 @@ struct tank_entity_params
 
 ecs::entity& create_entity_tank( const tank_entity_params& params, ecs::world& world );
 
+// All of the tanks share the parameters
+std::vector< ecs::entity* > create_enemy_tanks( const tank_entity_params& params, size_t count, ecs::world& world );
+
 QString tile_image_path( const tile_type& type );
 
 }// game
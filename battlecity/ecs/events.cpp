@@ -100,8 +100,10 @@ action_done::action_done( const object_type& subject_type,
                           ecs::entity* performer ) noexcept:
     m_subject_type( subject_type ),
     m_subject( &subject ),
+    m_subject_id( subject.get_id() ),
     m_performer_type( performer_type ),
-    m_performer( performer ){}
+    m_performer( performer ),
+    m_performer_id( performer? performer->get_id() : INVALID_NUMERIC_ID ){}
 
 ecs::entity* action_done::get_performer() const noexcept
 {
@@ -113,6 +115,16 @@ ecs::entity& action_done::get_subject() const noexcept
     return *m_subject;
 }
 
+ecs::entity_id action_done::get_performer_id() const noexcept
+{
+    return m_performer_id;
+}
+
+ecs::entity_id action_done::get_subject_id() const noexcept
+{
+    return m_subject_id;
+}
+
 const object_type& action_done::get_performer_type() const noexcept
 {
     return m_performer_type;
@@ -150,6 +162,23 @@ const level_game_result& level_completed::get_result() const noexcept
 
 //
 
+move_direction_requested::move_direction_requested( ecs::entity_id id,
+                                                    const movement_direction& direction ) noexcept :
+    m_entity_id( id ),
+    m_direction( direction ){}
+
+ecs::entity_id move_direction_requested::get_entity_id() const noexcept
+{
+    return m_entity_id;
+}
+
+const movement_direction& move_direction_requested::get_direction() const noexcept
+{
+    return m_direction;
+}
+
+//
+
 projectile_fired::projectile_fired( ecs::entity& shooter, ecs::entity& projectile ) noexcept :
     m_shooter( shooter ),
     m_projectile( projectile ){}
@@ -2,6 +2,7 @@
 #define EVENTS_H
 
 #include <list>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "framework/entity.h"
@@ -108,7 +109,9 @@ private:
 namespace _detail
 {
 
-// Contains information of the collision
+// Contains information of the collision.
+// The entity pointers are only valid while the event is being emitted, receivers
+// handling it later( e.g. via a queued connection ) should check the ids with world::entity_present()
 class action_done
 {
 public:
@@ -120,14 +123,18 @@ public:
 
     ecs::entity* get_performer() const noexcept;
     ecs::entity& get_subject() const noexcept;
+    ecs::entity_id get_performer_id() const noexcept;
+    ecs::entity_id get_subject_id() const noexcept;
     const object_type& get_performer_type() const noexcept;
     const object_type& get_subject_type() const noexcept;
 
 private:
     object_type m_subject_type;
     ecs::entity* m_subject{ nullptr };
+    ecs::entity_id m_subject_id{ INVALID_NUMERIC_ID };
     object_type m_performer_type;
     ecs::entity* m_performer{ nullptr };
+    ecs::entity_id m_performer_id{ INVALID_NUMERIC_ID };
 };
 
 }// details
@@ -215,6 +222,21 @@ private:
 
 //
 
+// Posted by the GUI as an input event, see ecs::world::post_input()
+class move_direction_requested final
+{
+public:
+    move_direction_requested( ecs::entity_id id, const movement_direction& direction ) noexcept;
+    ecs::entity_id get_entity_id() const noexcept;
+    const movement_direction& get_direction() const noexcept;
+
+private:
+    ecs::entity_id m_entity_id;
+    movement_direction m_direction;
+};
+
+//
+
 class projectile_fired final
 {
 public:
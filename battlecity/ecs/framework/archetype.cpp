@@ -0,0 +1,202 @@
+#include "archetype.h"
+
+#include <stdexcept>
+
+static constexpr size_t no_column{ static_cast< size_t >( -1 ) };
+
+namespace ecs
+{
+
+template< typename value_type >
+void set_indexed( std::vector< value_type >& v, size_t index, const value_type& value, const value_type& empty )
+{
+    if( index >= v.size() )
+    {
+        v.resize( index + 1, empty );
+    }
+
+    v[ index ] = value;
+}
+
+component_signature mask_to_signature( const component_mask& mask )
+{
+    component_signature signature;
+    signature.reserve( mask.count() );
+
+    for( type_id id{ 0 }; id < mask.size(); ++id )
+    {
+        if( mask.test( id ) )
+        {
+            signature.emplace_back( id );
+        }
+    }
+
+    return signature;
+}
+
+archetype::archetype( const component_mask& mask ) :
+    m_mask( mask ),
+    m_signature( mask_to_signature( mask ) ),
+    m_columns( m_signature.size() ),
+    m_changed_ticks( new std::atomic< uint64_t >[ m_signature.size() ]() )
+{
+    for( size_t column{ 0 }; column < m_signature.size(); ++column )
+    {
+        set_indexed( m_column_indices, m_signature[ column ], column, no_column );
+    }
+}
+
+const component_signature& archetype::get_signature() const noexcept
+{
+    return m_signature;
+}
+
+const component_mask& archetype::get_mask() const noexcept
+{
+    return m_mask;
+}
+
+bool archetype::has_component( const type_id& id ) const noexcept
+{
+    return id < m_mask.size() && m_mask.test( id );
+}
+
+bool archetype::has_components( const component_mask& mask ) const noexcept
+{
+    return ( m_mask & mask ) == mask;
+}
+
+size_t archetype::get_column_index( const type_id& id ) const
+{
+    if( !has_component( id ) )
+    {
+        throw std::out_of_range{ "Component is not a part of the archetype" };
+    }
+
+    return m_column_indices[ id ];
+}
+
+size_t archetype::size() const noexcept
+{
+    return m_entities.size();
+}
+
+bool archetype::empty() const noexcept
+{
+    return m_entities.empty();
+}
+
+entity& archetype::get_entity( size_t row ) const noexcept
+{
+    return *m_entities[ row ];
+}
+
+entity* const* archetype::get_entities() const noexcept
+{
+    return m_entities.data();
+}
+
+void* archetype::get_component( size_t row, size_t column ) const noexcept
+{
+    return m_columns[ column ][ row ];
+}
+
+void* const* archetype::get_column( size_t column ) const noexcept
+{
+    return m_columns[ column ].data();
+}
+
+uint64_t archetype::get_changed_tick( size_t column ) const noexcept
+{
+    return m_changed_ticks[ column ].load( std::memory_order_relaxed );
+}
+
+void archetype::mark_changed( size_t column, uint64_t tick ) noexcept
+{
+    // components of the same column may be changed from several threads
+    std::atomic< uint64_t >& changed = m_changed_ticks[ column ];
+    uint64_t current{ changed.load( std::memory_order_relaxed ) };
+
+    while( current < tick && !changed.compare_exchange_weak( current, tick, std::memory_order_relaxed ) ){}
+}
+
+size_t archetype::add_entity( entity& e )
+{
+    m_entities.emplace_back( &e );
+    for( auto& column : m_columns )
+    {
+        column.emplace_back( nullptr );
+    }
+
+    return m_entities.size() - 1;
+}
+
+void archetype::reserve( size_t size )
+{
+    m_entities.reserve( size );
+    for( auto& column : m_columns )
+    {
+        column.reserve( size );
+    }
+}
+
+void archetype::set_component( size_t row, size_t column, void* data ) noexcept
+{
+    m_columns[ column ][ row ] = data;
+}
+
+entity* archetype::remove_entity( size_t row ) noexcept
+{
+    entity* moved{ nullptr };
+    size_t last{ m_entities.size() - 1 };
+
+    if( row != last )
+    {
+        m_entities[ row ] = m_entities[ last ];
+        for( auto& column : m_columns )
+        {
+            column[ row ] = column[ last ];
+        }
+
+        moved = m_entities[ row ];
+    }
+
+    m_entities.pop_back();
+    for( auto& column : m_columns )
+    {
+        column.pop_back();
+    }
+
+    return moved;
+}
+
+void archetype::clear() noexcept
+{
+    m_entities.clear();
+    for( auto& column : m_columns )
+    {
+        column.clear();
+    }
+}
+
+archetype* archetype::get_add_edge( const type_id& id ) const noexcept
+{
+    return id < m_add_edges.size()? m_add_edges[ id ] : nullptr;
+}
+
+archetype* archetype::get_remove_edge( const type_id& id ) const noexcept
+{
+    return id < m_remove_edges.size()? m_remove_edges[ id ] : nullptr;
+}
+
+void archetype::set_add_edge( const type_id& id, archetype& a )
+{
+    set_indexed< archetype* >( m_add_edges, id, &a, nullptr );
+}
+
+void archetype::set_remove_edge( const type_id& id, archetype& a )
+{
+    set_indexed< archetype* >( m_remove_edges, id, &a, nullptr );
+}
+
+}// ecs
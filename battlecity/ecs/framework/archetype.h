@@ -0,0 +1,179 @@
+#ifndef ECS_ARCHETYPE_H
+#define ECS_ARCHETYPE_H
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "id_engine.h"
+
+namespace ecs
+{
+
+class entity;
+
+// Sorted list of the component types an entity consists of
+using component_signature = std::vector< type_id >;
+
+component_signature mask_to_signature( const component_mask& mask );
+
+// A typed view over one column of an archetype.
+// A column holds pointers to the components, which stay in their entity records: references
+// returned by entity::get_component() have to survive the entity moving between archetypes
+template< typename component_type >
+class component_span final
+{
+public:
+    component_span( void* const* data, size_t size ) noexcept :
+        m_data( data ),
+        m_size( size ){}
+
+    component_type& operator[]( size_t index ) const noexcept
+    {
+        return *static_cast< component_type* >( m_data[ index ] );
+    }
+
+    size_t size() const noexcept{ return m_size; }
+    bool empty() const noexcept{ return m_size == 0; }
+
+private:
+    void* const* m_data{ nullptr };
+    size_t m_size{ 0 };
+};
+
+// Table of all the entities sharing the same component signature.
+// Entities and the component pointers are stored as parallel arrays( one per component type ),
+// so iterating over an archetype needs no lookups, though each component is still one indirection away
+class archetype final
+{
+public:
+    explicit archetype( const component_mask& mask );
+    archetype( const archetype& ) = delete;
+    archetype( archetype&& ) = delete;
+    archetype& operator=( const archetype& ) = delete;
+    archetype& operator=( archetype&& ) = delete;
+
+    const component_signature& get_signature() const noexcept;
+    const component_mask& get_mask() const noexcept;
+
+    bool has_component( const type_id& id ) const noexcept;
+    bool has_components( const component_mask& mask ) const noexcept;
+
+    template< typename... components >
+    bool has_components() const
+    {
+        return has_components( get_component_mask< components... >() );
+    }
+
+    // Throws std::out_of_range if the archetype doesn't contain the component
+    size_t get_column_index( const type_id& id ) const;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    entity& get_entity( size_t row ) const noexcept;
+    entity* const* get_entities() const noexcept;
+    void* get_component( size_t row, size_t column ) const noexcept;
+    void* const* get_column( size_t column ) const noexcept;
+
+    // The latest change tick of the column components, see entity::get_component_mut().
+    // Isn't lowered when entities leave, so it may only tell that nothing has changed
+    uint64_t get_changed_tick( size_t column ) const noexcept;
+    void mark_changed( size_t column, uint64_t tick ) noexcept;
+
+    // Appends the entity, columns of the new row should be filled using set_component()
+    size_t add_entity( entity& e );
+    void reserve( size_t size );
+    void set_component( size_t row, size_t column, void* data ) noexcept;
+
+    // Swaps the row with the last one and pops it,
+    // returns the entity that has been moved to the row or nullptr
+    entity* remove_entity( size_t row ) noexcept;
+    void clear() noexcept;
+
+    // Cached transitions to the neighbour archetypes
+    archetype* get_add_edge( const type_id& id ) const noexcept;
+    archetype* get_remove_edge( const type_id& id ) const noexcept;
+    void set_add_edge( const type_id& id, archetype& a );
+    void set_remove_edge( const type_id& id, archetype& a );
+
+private:
+    component_mask m_mask;
+    component_signature m_signature;
+    std::vector< entity* > m_entities;
+    std::vector< std::vector< void* > > m_columns; // component addresses, not the values
+    std::vector< size_t > m_column_indices; // indexed by type id
+    std::unique_ptr< std::atomic< uint64_t >[] > m_changed_ticks; // per column
+
+    std::vector< archetype* > m_add_edges; // indexed by type id
+    std::vector< archetype* > m_remove_edges;
+};
+
+namespace _detail
+{
+
+// position of a type in the parameter pack
+template< typename type, typename... types >
+struct type_position;
+
+template< typename type, typename... tail >
+struct type_position< type, type, tail... > : std::integral_constant< size_t, 0 >{};
+
+template< typename type, typename head, typename... tail >
+struct type_position< type, head, tail... > :
+        std::integral_constant< size_t, 1 + type_position< type, tail... >::value >{};
+
+}// _detail
+
+// Part of an archetype handed over to the world::for_each_chunk() callbacks.
+// Contains the entities scheduled to be removed as well, so check the state if needed
+template< typename... components >
+class archetype_chunk final
+{
+public:
+    archetype_chunk( archetype& a, const size_t* columns ) noexcept :
+        m_archetype( a ),
+        m_columns( columns ){}
+
+    size_t size() const noexcept{ return m_archetype.size(); }
+    bool empty() const noexcept{ return m_archetype.empty(); }
+
+    entity& get_entity( size_t row ) const noexcept{ return m_archetype.get_entity( row ); }
+    entity* const* get_entities() const noexcept{ return m_archetype.get_entities(); }
+
+    template< typename component_type >
+    component_span< component_type > get_column() const noexcept
+    {
+        return { m_archetype.get_column( column_of< component_type >() ), m_archetype.size() };
+    }
+
+    template< typename component_type >
+    component_type& get_component( size_t row ) const noexcept
+    {
+        return *static_cast< component_type* >(
+                    m_archetype.get_component( row, column_of< component_type >() ) );
+    }
+
+    // The chunk has no components changed after the returned tick
+    template< typename component_type >
+    uint64_t get_changed_tick() const noexcept
+    {
+        return m_archetype.get_changed_tick( column_of< component_type >() );
+    }
+
+private:
+    template< typename component_type >
+    size_t column_of() const noexcept
+    {
+        return m_columns[ _detail::type_position< component_type, components... >::value ];
+    }
+
+private:
+    archetype& m_archetype;
+    const size_t* m_columns{ nullptr };
+};
+
+}// ecs
+
+#endif
@@ -0,0 +1,56 @@
+#include "command_buffer.h"
+
+namespace ecs
+{
+
+namespace _detail
+{
+
+constexpr size_t command_order::no_system;
+
+bool operator<( const command_order& l, const command_order& r ) noexcept
+{
+    return l.system < r.system || ( l.system == r.system && l.step < r.step );
+}
+
+command_order& current_command_order() noexcept
+{
+    static thread_local command_order order;
+    return order;
+}
+
+}// _detail
+
+void command_buffer::create_entity( entity_func init )
+{
+    record( command_type::create, INVALID_NUMERIC_ID, std::move( init ) );
+}
+
+void command_buffer::create_entity( create_func create, entity_func init )
+{
+    record( command_type::create, INVALID_NUMERIC_ID, std::move( init ), std::move( create ) );
+}
+
+void command_buffer::destroy_entity( entity_id id )
+{
+    record( command_type::destroy, id, entity_func{} );
+}
+
+void command_buffer::apply( entity_id id, entity_func func )
+{
+    record( command_type::apply, id, std::move( func ) );
+}
+
+bool command_buffer::empty() const
+{
+    std::lock_guard< std::mutex > l{ m_mutex };
+    return m_commands.empty();
+}
+
+void command_buffer::record( command_type type, entity_id id, entity_func func, create_func create )
+{
+    std::lock_guard< std::mutex > l{ m_mutex };
+    m_commands.emplace_back( command{ type, id, std::move( func ), std::move( create ), _detail::current_command_order() } );
+}
+
+}// ecs
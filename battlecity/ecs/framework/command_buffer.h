@@ -0,0 +1,148 @@
+#ifndef ECS_COMMAND_BUFFER_H
+#define ECS_COMMAND_BUFFER_H
+
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <functional>
+#include <type_traits>
+
+#include "entity.h"
+
+namespace ecs
+{
+
+class world;
+
+namespace _detail
+{
+
+template< typename component_type, typename... args >
+struct add_component_command
+{
+    void operator()( entity& e )
+    {
+        add( e, std::index_sequence_for< args... >{} );
+    }
+
+    template< size_t... seq >
+    void add( entity& e, const std::integer_sequence< size_t, seq... >& )
+    {
+        e.add_component< component_type >( std::get< seq >( arguments )... );
+    }
+
+    std::tuple< args... > arguments;
+};
+
+// Playback position of the commands: the schedule position of the system recording them,
+// then the step within the system, the tasks of its parallel loops get the steps of their own.
+// So the order doesn't depend on which workers have run the systems
+struct command_order
+{
+    static constexpr size_t no_system{ static_cast< size_t >( -1 ) }; // played after the systems
+
+    command_order() = default;
+    command_order( size_t system, size_t step ) noexcept :
+        system( system ),
+        step( step ){}
+
+    size_t system{ no_system };
+    size_t step{ 0 };
+};
+
+bool operator<( const command_order& l, const command_order& r ) noexcept;
+
+// Order of the commands recorded by the calling thread
+command_order& current_command_order() noexcept;
+
+// Sets the order of the calling thread until the end of the scope
+class command_order_scope final
+{
+public:
+    explicit command_order_scope( const command_order& order ) noexcept :
+        m_previous( current_command_order() )
+    {
+        current_command_order() = order;
+    }
+
+    ~command_order_scope()
+    {
+        current_command_order() = m_previous;
+    }
+
+    command_order_scope( const command_order_scope& ) = delete;
+    command_order_scope& operator=( const command_order_scope& ) = delete;
+
+private:
+    command_order m_previous;
+};
+
+}// _detail
+
+// Structural changes recorded by a single thread, see world::get_command_buffer().
+// The world plays them back at its sync points in the schedule order of the systems
+// that have recorded them( see _detail::command_order ), the commands of a system in the recording order.
+// Commands targeting entities removed in the meantime are skipped
+class command_buffer final
+{
+    friend class world;
+
+public:
+    using entity_func = std::function< void( entity& ) >;
+    using create_func = std::function< entity&( world& ) >;
+
+    command_buffer() = default;
+    command_buffer( const command_buffer& ) = delete;
+    command_buffer& operator=( const command_buffer& ) = delete;
+
+    // init is called for the created entity during the playback
+    void create_entity( entity_func init = entity_func{} );
+
+    // Same, but the entity is made by create during the playback, e.g. by world::recycle_or_create()
+    void create_entity( create_func create, entity_func init );
+    void destroy_entity( entity_id id );
+
+    // the arguments are copied and passed to the component constructor during the playback
+    template< typename component_type, typename... args >
+    void add_component( entity_id id, args&&... constructor_args )
+    {
+        using command_type = _detail::add_component_command< component_type, typename std::decay< args >::type... >;
+        apply( id, command_type{ std::make_tuple( std::forward< args >( constructor_args )... ) } );
+    }
+
+    template< typename... components >
+    void remove_components( entity_id id )
+    {
+        apply( id, []( entity& e )
+        {
+            e.remove_components< components... >();
+        } );
+    }
+
+    // Calls func for the entity during the playback
+    void apply( entity_id id, entity_func func );
+
+    bool empty() const;
+
+private:
+    enum class command_type{ create, destroy, apply };
+
+    struct command
+    {
+        command_type type;
+        entity_id id;
+        entity_func func;
+        create_func create; // only for command_type::create, makes an empty entity if not set
+        _detail::command_order order;
+    };
+
+    void record( command_type type, entity_id id, entity_func func, create_func create = create_func{} );
+
+private:
+    std::vector< command > m_commands;
+    mutable std::mutex m_mutex; // recording thread vs playback
+};
+
+}// ecs
+
+#endif
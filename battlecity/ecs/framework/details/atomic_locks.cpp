@@ -7,21 +7,32 @@ namespace ecs
 
 void spinlock::lock() noexcept
 {
-    while( m_flag.test_and_set( std::memory_order_acquire ) );
+    _detail::backoff b;
+
+    // only try to take the lock once it looks free, so the waiting threads don't bounce the cache line
+    while( m_locked.load( std::memory_order_relaxed ) || m_locked.exchange( true, std::memory_order_acquire ) )
+    {
+        b.pause();
+    }
 }
 
 bool spinlock::try_lock() noexcept
 {
-    return !m_flag.test_and_set( std::memory_order_acquire );
+    return !m_locked.load( std::memory_order_relaxed ) && !m_locked.exchange( true, std::memory_order_acquire );
 }
 
 void spinlock::unlock() noexcept
 {
-    m_flag.clear( std::memory_order_release );
+    m_locked.store( false, std::memory_order_release );
 }
 
 //
 
+constexpr uint32_t rw_spinlock::readers_mask;
+constexpr uint32_t rw_spinlock::waiting_writer;
+constexpr uint32_t rw_spinlock::waiting_writers_mask;
+constexpr uint32_t rw_spinlock::writer;
+
 void rw_spinlock::lock( const lock_mode& mode ) noexcept
 {
     return mode == lock_mode::read? lock_read() : lock_write();
@@ -39,67 +50,72 @@ void rw_spinlock::unlock( const lock_mode& mode ) noexcept
 
 void rw_spinlock::lock_read() noexcept
 {
-    while( true )
-    {
-        uint_fast32_t old_lock{ m_lock & 0x7fffffff };
-        uint_fast32_t new_lock{ old_lock + 1 };
+    _detail::backoff b;
 
-        if( m_lock.compare_exchange_weak( old_lock, new_lock, std::memory_order_acquire ) )
-        {
-            return;
-        }
+    while( !try_lock_read() )
+    {
+        b.pause();
     }
 }
 
 bool rw_spinlock::try_lock_read() noexcept
 {
-    uint_fast32_t old_lock{ m_lock & 0x7fffffff };
-    uint_fast32_t new_lock{ old_lock + 1 };
+    uint32_t state{ m_state.load( std::memory_order_relaxed ) };
 
-    return m_lock.compare_exchange_strong( old_lock, new_lock, std::memory_order_acquire );
+    // waiting writers go first
+    return !( state & ( writer | waiting_writers_mask ) ) &&
+           m_state.compare_exchange_strong( state, state + 1, std::memory_order_acquire, std::memory_order_relaxed );
 }
 
 void rw_spinlock::lock_write() noexcept
 {
-    while( true )
+    announce_writer();
+
+    _detail::backoff b;
+
+    while( !try_lock_announced_write() )
     {
-        uint_fast32_t old_lock{ m_lock & 0x7fffffff };
-        uint_fast32_t new_lock{ old_lock | 0x80000000 };
-
-        if( m_lock.compare_exchange_weak( old_lock, new_lock, std::memory_order_acquire ) )
-        {
-            while( m_lock & 0x7fffffff );// wait for readers to finish
-            return;
-        }
+        b.pause();
     }
 }
 
 bool rw_spinlock::try_lock_write() noexcept
 {
-    uint_fast32_t expected{ 0 };
-    return m_lock.compare_exchange_strong( expected, 0x80000000, std::memory_order_acquire );
+    uint32_t state{ m_state.load( std::memory_order_relaxed ) };
+    return !( state & ( writer | readers_mask ) ) &&
+           m_state.compare_exchange_strong( state, state | writer, std::memory_order_acquire, std::memory_order_relaxed );
 }
 
-void rw_spinlock::unlock_read() noexcept
+bool rw_spinlock::try_lock_announced_write() noexcept
 {
-    assert( m_lock & 0x7fffffff );
+    uint32_t state{ m_state.load( std::memory_order_relaxed ) };
+    return !( state & ( writer | readers_mask ) ) &&
+           m_state.compare_exchange_strong( state, state - waiting_writer + writer,
+                                            std::memory_order_acquire, std::memory_order_relaxed );
+}
 
-    while( true )
-    {
-        uint_fast32_t old_lock{ m_lock };
-        uint_fast32_t new_lock{ m_lock - 1 };
+void rw_spinlock::announce_writer() noexcept
+{
+    // the new readers wait until the writer is done
+    m_state.fetch_add( waiting_writer, std::memory_order_relaxed );
+}
 
-        if( m_lock.compare_exchange_weak( old_lock, new_lock, std::memory_order_acquire ) )
-        {
-            return;
-        }
-    }
+void rw_spinlock::withdraw_writer() noexcept
+{
+    assert( m_state.load( std::memory_order_relaxed ) & waiting_writers_mask );
+    m_state.fetch_sub( waiting_writer, std::memory_order_relaxed );
+}
+
+void rw_spinlock::unlock_read() noexcept
+{
+    assert( m_state.load( std::memory_order_relaxed ) & readers_mask );
+    m_state.fetch_sub( 1, std::memory_order_release );
 }
 
 void rw_spinlock::unlock_write() noexcept
 {
-    assert( m_lock == 0x80000000 );
-    m_lock = 0;
+    assert( m_state.load( std::memory_order_relaxed ) & writer );
+    m_state.fetch_sub( writer, std::memory_order_release );
 }
 
 }//ecs
@@ -3,23 +3,125 @@
 
 #include <chrono>
 #include <atomic>
+#include <thread>
+#include <cstdint>
+
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+#include <immintrin.h>
+#endif
 
 #include "rw_lock_modes.h"
 
+// Max number of pause instructions issued by a single backoff step
+#ifndef ECS_SPIN_MAX_PAUSES
+#define ECS_SPIN_MAX_PAUSES 64
+#endif
+
+// Number of backoff steps after which a spinning thread yields its time slice, 0 never yields
+#ifndef ECS_SPIN_YIELD_AFTER
+#define ECS_SPIN_YIELD_AFTER 16
+#endif
+
+#ifndef ECS_CACHE_LINE_SIZE
+#define ECS_CACHE_LINE_SIZE 64
+#endif
+
 namespace ecs
 {
 
-class spinlock final
+namespace _detail
+{
+
+// Tells the CPU it's in a spin wait loop
+inline void cpu_relax() noexcept
+{
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+    _mm_pause();
+#elif defined( __aarch64__ ) || defined( __arm__ )
+    asm volatile( "yield" );
+#endif
+}
+
+// Exponential backoff of a spin wait loop, the number of pauses doubles each step
+class backoff
+{
+public:
+    void pause() noexcept
+    {
+        if( ECS_SPIN_YIELD_AFTER && m_steps >= ECS_SPIN_YIELD_AFTER )
+        {
+            std::this_thread::yield();
+            return;
+        }
+
+        for( uint32_t i{ 0 }; i < m_pauses; ++i )
+        {
+            cpu_relax();
+        }
+
+        if( m_pauses < ECS_SPIN_MAX_PAUSES )
+        {
+            m_pauses <<= 1;
+        }
+
+        ++m_steps;
+    }
+
+private:
+    uint32_t m_pauses{ 1 };
+    uint32_t m_steps{ 0 };
+};
+
+// try_lock is a bool() noexcept callable making a single attempt
+template< typename rep, typename period, typename try_lock_func >
+bool try_lock_until_timeout( const std::chrono::duration< rep, period >& timeout, try_lock_func&& try_lock ) noexcept
+{
+    using clock = std::chrono::steady_clock;
+
+    auto deadline = clock::now() + timeout;
+    backoff b;
+
+    while( !try_lock() )
+    {
+        if( clock::now() >= deadline )
+        {
+            return false;
+        }
+
+        b.pause();
+    }
+
+    return true;
+}
+
+}// _detail
+
+class spinlock
 {
 public:
     void lock() noexcept;
     bool try_lock() noexcept;
     void unlock() noexcept;
 
+    // rw_lock_guard interface, both modes are exclusive
+    void lock( const lock_mode& ) noexcept{ lock(); }
+    bool try_lock( const lock_mode& ) noexcept{ return try_lock(); }
+
+    template< typename rep, typename period >
+    bool try_lock_for( const lock_mode&, const std::chrono::duration< rep, period >& timeout ) noexcept
+    {
+        return _detail::try_lock_until_timeout( timeout, [ this ]{ return try_lock(); } );
+    }
+
+    void unlock( const lock_mode& ) noexcept{ unlock(); }
+
 private:
-    std::atomic_flag m_flag{ ATOMIC_FLAG_INIT };
+    std::atomic< bool > m_locked{ false };
 };
 
+// Writers have priority: once a writer waits, no new readers are let in,
+// so the writer only waits for the current readers to finish.
+// A single try_lock( write ) doesn't wait, so it doesn't hold the readers back
 class rw_spinlock
 {
 public:
@@ -29,20 +131,20 @@ public:
     template< typename rep, typename period >
     bool try_lock_for( const lock_mode& mode, const std::chrono::duration< rep, period >& timeout ) noexcept
     {
-        using namespace std::chrono;
-        using clock = high_resolution_clock;
-        using timeout_type = duration< rep, period >;
+        if( mode == lock_mode::read )
+        {
+            return _detail::try_lock_until_timeout( timeout, [ this ]{ return try_lock_read(); } );
+        }
 
-        auto start = clock::now();
-        while( duration_cast< timeout_type >( clock::now() - start ) < timeout )
+        // the writer is announced while it waits and withdrawn on timeout
+        announce_writer();
+        if( !_detail::try_lock_until_timeout( timeout, [ this ]{ return try_lock_announced_write(); } ) )
         {
-            if( try_lock( mode ) )
-            {
-                return true;
-            }
+            withdraw_writer();
+            return false;
         }
 
-        return false;
+        return true;
     }
 
     void unlock( const lock_mode& mode ) noexcept;
@@ -53,14 +155,27 @@ private:
 
     void lock_write() noexcept;
     bool try_lock_write() noexcept;
+    bool try_lock_announced_write() noexcept;
+    void announce_writer() noexcept;
+    void withdraw_writer() noexcept;
 
     void unlock_read() noexcept;
     void unlock_write() noexcept;
 
 private:
-    std::atomic_uint_fast32_t m_lock{ 0 };
+    // readers in the low bits, then the waiting writers, the top bit is set while a writer holds the lock
+    static constexpr uint32_t readers_mask{ 0x0000ffff };
+    static constexpr uint32_t waiting_writer{ 0x00010000 };
+    static constexpr uint32_t waiting_writers_mask{ 0x7fff0000 };
+    static constexpr uint32_t writer{ 0x80000000 };
+
+    std::atomic< uint32_t > m_state{ 0 };
 };
 
+// Occupies whole cache lines, so that the locks contended by different threads don't share them.
+// Meant for standalone locks, components would grow too much
+class alignas( ECS_CACHE_LINE_SIZE ) padded_rw_spinlock : public rw_spinlock{};
+
 }// ecs
 
 #endif
@@ -0,0 +1,89 @@
+#ifndef ECS_BLOCK_POOL_H
+#define ECS_BLOCK_POOL_H
+
+#include <new>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+namespace ecs
+{
+
+namespace _detail
+{
+
+// Allocates the objects of a type in chunks and reuses the freed slots, so the objects never move
+// and there's no allocation per object. All the objects should be destroyed before the pool. Not thread safe
+template< typename type, size_t chunk_size = 64 >
+class block_pool final
+{
+public:
+    block_pool() = default;
+    block_pool( const block_pool& ) = delete;
+    block_pool& operator=( const block_pool& ) = delete;
+
+    template< typename... constructor_args >
+    type* create( constructor_args&&... args )
+    {
+        slot* s{ acquire() };
+
+        try
+        {
+            return new( &s->storage ) type( std::forward< constructor_args >( args )... );
+        }
+        catch( ... )
+        {
+            release( s );
+            throw;
+        }
+    }
+
+    void destroy( type* object ) noexcept
+    {
+        object->~type();
+        release( reinterpret_cast< slot* >( object ) );
+    }
+
+private:
+    union slot
+    {
+        slot* next;
+        typename std::aligned_storage< sizeof( type ), std::alignment_of< type >::value >::type storage;
+    };
+
+    slot* acquire()
+    {
+        if( m_free )
+        {
+            slot* s{ m_free };
+            m_free = s->next;
+            return s;
+        }
+
+        if( m_chunks.empty() || m_used == chunk_size )
+        {
+            m_chunks.emplace_back( new slot[ chunk_size ] );
+            m_used = 0;
+        }
+
+        return &m_chunks.back()[ m_used++ ];
+    }
+
+    void release( slot* s ) noexcept
+    {
+        s->next = m_free;
+        m_free = s;
+    }
+
+private:
+    std::vector< std::unique_ptr< slot[] > > m_chunks;
+    slot* m_free{ nullptr };
+    size_t m_used{ 0 }; // slots taken from the last chunk
+};
+
+}// _detail
+
+}// ecs
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef ECS_LOCK_POLICY_H
+#define ECS_LOCK_POLICY_H
+
+#include <chrono>
+#include <type_traits>
+
+#include "rw_lock.h"
+#include "atomic_locks.h"
+#include "rw_lock_guard.h"
+#include "rw_lock_modes.h"
+
+namespace ecs
+{
+
+// Lock of the types never accessed concurrently, all operations are no-ops
+class no_lock
+{
+public:
+    void lock( const lock_mode& ) noexcept{}
+    bool try_lock( const lock_mode& ) noexcept{ return true; }
+
+    template< typename rep, typename period >
+    bool try_lock_for( const lock_mode&, const std::chrono::duration< rep, period >& ) noexcept
+    {
+        return true;
+    }
+
+    void unlock( const lock_mode& ) noexcept{}
+};
+
+// Components choose their lock by inheriting use_lock< lock_type >, where lock_type is one
+// of no_lock, spinlock, rw_spinlock and rw_lock. Defining ECS_LOCK_NONE turns all of them
+// into no_lock for single threaded builds
+#ifdef ECS_LOCK_NONE
+template< typename lock_type >
+using use_lock = no_lock;
+#else
+template< typename lock_type >
+using use_lock = lock_type;
+#endif
+
+// The lock the type inherits, specialize to override
+template< typename type >
+struct lock_policy_of
+{
+    using lock_type =
+        typename std::conditional< std::is_base_of< rw_lock, type >::value, rw_lock,
+        typename std::conditional< std::is_base_of< rw_spinlock, type >::value, rw_spinlock,
+        typename std::conditional< std::is_base_of< spinlock, type >::value, spinlock,
+        no_lock >::type >::type >::type;
+};
+
+// Guard locking an object of the type according to its lock policy,
+// e.g. lock_guard_for< geometry > l{ g, lock_mode::read }
+template< typename type >
+using lock_guard_for = rw_lock_guard< typename lock_policy_of< type >::lock_type >;
+
+template<>
+class rw_lock_guard< no_lock >
+{
+public:
+    // accepts the types without any lock as well
+    template< typename type >
+    explicit rw_lock_guard( type&,
+                            const lock_mode&,
+                            const lock_policy& policy = lock_policy::instant ) noexcept :
+        m_owns_lock( policy == lock_policy::instant ){}
+
+    rw_lock_guard( const rw_lock_guard& ) = delete;
+    rw_lock_guard( rw_lock_guard&& ) = delete;
+    rw_lock_guard& operator=(const rw_lock_guard&) = delete;
+    rw_lock_guard& operator=( rw_lock_guard&& ) = delete;
+
+    void lock() noexcept{ m_owns_lock = true; }
+    bool try_lock() noexcept{ return m_owns_lock = true; }
+
+    template< typename rep, typename period >
+    bool try_lock_for( const std::chrono::duration< rep, period >& ) noexcept
+    {
+        return m_owns_lock = true;
+    }
+
+    void unlock() noexcept{ m_owns_lock = false; }
+
+    bool owns_lock() const noexcept{ return m_owns_lock; }
+    void release() noexcept{ m_owns_lock = false; }
+
+private:
+    bool m_owns_lock{ false };
+};
+
+}// ecs
+
+#endif
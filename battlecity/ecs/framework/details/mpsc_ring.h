@@ -0,0 +1,149 @@
+#ifndef ECS_MPSC_RING_H
+#define ECS_MPSC_RING_H
+
+#include <new>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace ecs
+{
+
+namespace _detail
+{
+
+// Bounded lock free queue, any number of threads may push while a single thread pops.
+// Every cell has a sequence number telling whether it's free for the producers( == position )
+// or holds a value for the consumer( == position + 1 )
+template< typename type >
+class mpsc_ring final
+{
+    static_assert( std::is_nothrow_copy_constructible< type >::value,
+                   "A claimed cell can't be released, so copying into it shouldn't throw" );
+
+public:
+    // the capacity is rounded up to a power of two
+    explicit mpsc_ring( size_t capacity )
+    {
+        size_t size{ 1 };
+        while( size < capacity )
+        {
+            size <<= 1;
+        }
+
+        m_cells = std::vector< cell >( size );
+        m_mask = size - 1;
+
+        for( size_t i{ 0 }; i < size; ++i )
+        {
+            m_cells[ i ].sequence.store( i, std::memory_order_relaxed );
+        }
+    }
+
+    mpsc_ring( const mpsc_ring& ) = delete;
+    mpsc_ring& operator=( const mpsc_ring& ) = delete;
+
+    ~mpsc_ring()
+    {
+        clear();
+    }
+
+    size_t capacity() const noexcept
+    {
+        return m_cells.size();
+    }
+
+    // Returns false if the ring is full
+    bool try_push( const type& value ) noexcept
+    {
+        size_t pos{ m_head.load( std::memory_order_relaxed ) };
+        cell* c{ nullptr };
+
+        while( true )
+        {
+            c = &m_cells[ pos & m_mask ];
+            size_t sequence{ c->sequence.load( std::memory_order_acquire ) };
+            intptr_t diff{ static_cast< intptr_t >( sequence ) - static_cast< intptr_t >( pos ) };
+
+            if( diff == 0 )
+            {
+                if( m_head.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                {
+                    break;
+                }
+            }
+            else if( diff < 0 )
+            {
+                return false; // the consumer hasn't released the cell yet
+            }
+            else
+            {
+                pos = m_head.load( std::memory_order_relaxed );
+            }
+        }
+
+        new( &c->storage ) type( value );
+        c->sequence.store( pos + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Calls func for the oldest value and removes it, returns false if the ring is empty.
+    // Should only be called by the consumer thread
+    template< typename func_type >
+    bool try_pop( func_type&& func )
+    {
+        cell& c = m_cells[ m_tail & m_mask ];
+        if( c.sequence.load( std::memory_order_acquire ) != m_tail + 1 )
+        {
+            return false;
+        }
+
+        try
+        {
+            func( *reinterpret_cast< type* >( &c.storage ) );
+        }
+        catch( ... )
+        {
+            release( c );
+            throw;
+        }
+
+        release( c );
+        return true;
+    }
+
+    // Should only be called by the consumer thread
+    void clear() noexcept
+    {
+        while( try_pop( []( const type& ){} ) ){}
+    }
+
+private:
+    struct cell
+    {
+        std::atomic< size_t > sequence{ 0 };
+        typename std::aligned_storage< sizeof( type ), std::alignment_of< type >::value >::type storage;
+    };
+
+    // destroys the popped value and hands the cell over to the producers
+    void release( cell& c ) noexcept
+    {
+        reinterpret_cast< type* >( &c.storage )->~type();
+        c.sequence.store( m_tail + m_cells.size(), std::memory_order_release );
+        ++m_tail;
+    }
+
+private:
+    std::vector< cell > m_cells;
+    size_t m_mask{ 0 };
+
+    alignas( 64 ) std::atomic< size_t > m_head{ 0 }; // next position to push to
+    alignas( 64 ) size_t m_tail{ 0 }; // next position to pop from
+};
+
+}// _detail
+
+}// ecs
+
+#endif
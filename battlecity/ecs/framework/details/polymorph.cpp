@@ -3,17 +3,66 @@
 namespace ecs
 {
 
-polymorph::polymorph( polymorph&& other ) noexcept : m_data( std::move( other.m_data ) ){}
+namespace _detail
+{
+
+void throw_bad_polymorph_cast()
+{
+    throw std::bad_cast{};
+}
+
+}// _detail
+
+polymorph::~polymorph()
+{
+    reset();
+}
+
+polymorph::polymorph( polymorph&& other ) noexcept
+{
+    *this = std::move( other );
+}
 
 polymorph& polymorph::operator=( polymorph&& other ) noexcept
 {
-    m_data = std::move( other.m_data );
+    if( this != &other )
+    {
+        reset();
+
+        if( !other.empty() )
+        {
+            if( other.m_ops->stored_inline )
+            {
+                other.m_ops->move( other.m_data, &m_buffer );
+                m_data = &m_buffer;
+            }
+            else
+            {
+                m_data = other.m_data;
+            }
+
+            m_ops = other.m_ops;
+            other.m_ops = nullptr;
+            other.m_data = nullptr;
+        }
+    }
+
     return *this;
 }
 
 const std::type_info& polymorph::type_info() const noexcept
 {
-  return empty()? typeid( void ) : m_data->type_info();
+    return empty()? typeid( void ) : m_ops->type_info();
+}
+
+void* polymorph::data() noexcept
+{
+    return m_data;
+}
+
+const void* polymorph::data() const noexcept
+{
+    return m_data;
 }
 
 bool polymorph::empty() const noexcept
@@ -21,4 +70,28 @@ bool polymorph::empty() const noexcept
     return ( m_data == nullptr );
 }
 
+void polymorph::reset() noexcept
+{
+    if( !empty() )
+    {
+        m_ops->destroy( m_data );
+        m_ops = nullptr;
+        m_data = nullptr;
+    }
+}
+
+void polymorph::discard() noexcept
+{
+    if( !empty() )
+    {
+        if( !m_ops->stored_inline )
+        {
+            ::operator delete( m_data );
+        }
+
+        m_ops = nullptr;
+        m_data = nullptr;
+    }
+}
+
 }// ecs
@@ -1,13 +1,31 @@
 #ifndef ECS_POLYMORPH_H
 #define ECS_POLYMORPH_H
 
-#include <memory>
+#include <new>
+#include <utility>
 #include <typeinfo>
+#include <exception>
+#include <type_traits>
+
+#include "../id_engine.h"
+
+// Objects not larger than this are stored inside the polymorph itself
+#ifndef ECS_POLYMORPH_INLINE_SIZE
+#define ECS_POLYMORPH_INLINE_SIZE ( 4 * sizeof( void* ) )
+#endif
+
+// Type checks of the checked getters are only performed in debug builds,
+// define ECS_POLYMORPH_CHECKS to keep them in release as well
+#if !defined( ECS_POLYMORPH_CHECKS ) && !defined( NDEBUG )
+#define ECS_POLYMORPH_CHECKS
+#endif
 
 namespace ecs
 {
 
-namespace _detail{ class base_type_storage; }
+struct polymorph_family{};
+
+namespace _detail{ struct polymorph_ops; }
 
 class polymorph
 {
@@ -15,8 +33,19 @@ class polymorph
   using disable_if_polymorph = typename std::enable_if< !std::is_same<
     typename std::decay< type >::type, polymorph >::value >::type;
 
+  using buffer_type = std::aligned_storage< ECS_POLYMORPH_INLINE_SIZE >::type;
+
 public:
+    // Small nothrow movable types are stored inline, others are allocated on the heap.
+    // Inline objects are moved along with the polymorph, so their addresses aren't stable
+    template< typename type >
+    struct stored_inline : std::integral_constant< bool,
+            sizeof( type ) <= sizeof( buffer_type ) &&
+            std::alignment_of< buffer_type >::value % std::alignment_of< type >::value == 0 &&
+            std::is_nothrow_move_constructible< type >::value >{};
+
     polymorph() = default;
+    ~polymorph();
 
     template< typename type, typename = disable_if_polymorph< type > >
     polymorph( type&& t ); // internal data assignment  constructor
@@ -29,6 +58,10 @@ public:
     polymorph& operator=( const polymorph& other ) = delete;
     polymorph& operator=( polymorph&& other ) noexcept;
 
+    // Destroys the current object and constructs a new one in place
+    template< typename type, typename... constructor_args >
+    type& emplace( constructor_args&&... args );
+
     template< typename type >
     type& get();
 
@@ -47,10 +80,20 @@ public:
 
     const std::type_info& type_info() const noexcept;
 
+    void* data() noexcept;
+    const void* data() const noexcept;
+
     bool empty() const noexcept;
+    void reset() noexcept;
+
+    // Frees the storage without calling the destructor,
+    // for objects that have already been destroyed externally
+    void discard() noexcept;
 
 private:
-    std::unique_ptr< _detail::base_type_storage > m_data;
+    const _detail::polymorph_ops* m_ops{ nullptr };
+    void* m_data{ nullptr }; // points either to m_buffer or to the heap
+    buffer_type m_buffer;
 };
 
 }// ecs
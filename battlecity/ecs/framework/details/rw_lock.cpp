@@ -36,7 +36,7 @@ void rw_lock::lock_read()
 {
     std::unique_lock< std::mutex > l{ m_mutex };
 
-    m_read_cv.wait( l, [ this ]{ return !m_writer_waiting; } );
+    m_read_cv.wait( l, [ this ]{ return can_read(); } );
     ++m_readers_num;
 }
 
@@ -44,15 +44,18 @@ void rw_lock::lock_write()
 {
     std::unique_lock< std::mutex > l{ m_mutex };
 
-    m_writer_waiting = true;
-    m_write_cv.wait( l, [ this ]{ return !m_readers_num; } );
+    ++m_writers_waiting;
+    m_write_cv.wait( l, [ this ]{ return can_write(); } );
+    --m_writers_waiting;
+
+    m_writer_active = true;
 }
 
 bool rw_lock::try_lock_read()
 {
     std::lock_guard< std::mutex > l{ m_mutex };
 
-    bool result{ !m_writer_waiting };
+    bool result{ can_read() };
     if( result )
     {
         ++m_readers_num;
@@ -65,10 +68,10 @@ bool rw_lock::try_lock_write()
 {
     std::lock_guard< std::mutex > l{ m_mutex };
 
-    bool result{ !m_readers_num };
+    bool result{ can_write() };
     if( result )
     {
-        m_writer_waiting = true;
+        m_writer_active = true;
     }
 
     return result;
@@ -90,8 +93,17 @@ void rw_lock::unlock_write()
 {
     std::lock_guard< std::mutex > l{ m_mutex };
 
-    m_writer_waiting = false;
-    m_read_cv.notify_all();
+    m_writer_active = false;
+
+    // the waiting writers go first, the readers are let in once there are none
+    if( m_writers_waiting )
+    {
+        m_write_cv.notify_one();
+    }
+    else
+    {
+        m_read_cv.notify_all();
+    }
 }
 
 }// ecs
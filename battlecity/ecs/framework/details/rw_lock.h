@@ -35,13 +35,26 @@ public:
 
         if( mode == lock_mode::read )
         {
-            result = m_read_cv.wait_for( l, timeout, [ this ]{ return !m_writer_waiting; } );
-            ++m_readers_num;
+            result = m_read_cv.wait_for( l, timeout, [ this ]{ return can_read(); } );
+            if( result )
+            {
+                ++m_readers_num;
+            }
         }
         else
         {
-            m_writer_waiting = true;
-            result = m_write_cv.wait( l, [ this ]{ return !m_readers_num; } );
+            ++m_writers_waiting;
+            result = m_write_cv.wait_for( l, timeout, [ this ]{ return can_write(); } );
+            --m_writers_waiting;
+
+            if( result )
+            {
+                m_writer_active = true;
+            }
+            else if( !m_writers_waiting )
+            {
+                m_read_cv.notify_all();
+            }
         }
 
         return result;
@@ -59,13 +72,17 @@ private:
     void unlock_read();
     void unlock_write();
 
+    bool can_read() const noexcept{ return !m_writers_waiting && !m_writer_active; }
+    bool can_write() const noexcept{ return !m_readers_num && !m_writer_active; }
+
 private:
     std::mutex m_mutex;
     std::condition_variable m_read_cv;
     std::condition_variable m_write_cv;
 
     size_t m_readers_num{ 0 };
-    bool m_writer_waiting{ false };
+    size_t m_writers_waiting{ 0 };
+    bool m_writer_active{ false };
 };
 
 }// ecs
@@ -0,0 +1,189 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace ecs
+{
+
+namespace _detail
+{
+
+static constexpr size_t not_a_worker{ static_cast< size_t >( -1 ) };
+
+// index of the pool worker running on the current thread
+static thread_local size_t current_worker{ not_a_worker };
+
+thread_pool::thread_pool( size_t workers_num )
+{
+    if( workers_num == 0 )
+    {
+        workers_num = std::max< size_t >( std::thread::hardware_concurrency(), 1 );
+    }
+
+    m_threads.reserve( workers_num - 1 );
+    for( size_t worker{ 1 }; worker < workers_num; ++worker )
+    {
+        m_threads.emplace_back( &thread_pool::worker_loop, this, worker );
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard< std::mutex > l{ m_mutex };
+        m_stop = true;
+    }
+
+    m_cv.notify_all();
+    for( std::thread& t : m_threads )
+    {
+        t.join();
+    }
+}
+
+size_t thread_pool::get_workers_num() const noexcept
+{
+    return m_threads.size() + 1;
+}
+
+void thread_pool::parallel_for( size_t tasks_num, const task_func& func )
+{
+    bool nested{ current_worker != not_a_worker };
+    size_t worker{ nested? current_worker : 0 };
+
+    if( m_threads.empty() || tasks_num < 2 )
+    {
+        for( size_t task{ 0 }; task < tasks_num; ++task )
+        {
+            func( worker, task );
+        }
+
+        return;
+    }
+
+    std::unique_lock< std::mutex > submit_lock{ m_submit_mutex, std::defer_lock };
+    if( !nested )
+    {
+        submit_lock.lock();
+        current_worker = 0;
+    }
+
+    job j;
+    j.func = &func;
+    j.tasks_num = tasks_num;
+    j.runners = 1;
+
+    {
+        std::lock_guard< std::mutex > l{ m_mutex };
+        j.serial = ++m_last_serial;
+        m_jobs.emplace_back( &j );
+    }
+
+    m_cv.notify_all();
+    run_tasks( j, worker );
+
+    {
+        std::unique_lock< std::mutex > l{ m_mutex };
+
+        // all the tasks are taken, so nobody else joins the job
+        m_jobs.erase( std::find( m_jobs.begin(), m_jobs.end(), &j ) );
+        --j.runners;
+
+        // the earlier jobs aren't helped: this thread is inside one of their tasks, which may hold what the others need
+        while( j.runners != 0 )
+        {
+            job* other{ find_job( j.serial ) };
+            if( other )
+            {
+                help( *other, worker, l );
+            }
+            else
+            {
+                m_cv.wait( l );
+            }
+        }
+    }
+
+    if( !nested )
+    {
+        current_worker = not_a_worker;
+    }
+
+    if( j.error )
+    {
+        std::rethrow_exception( j.error );
+    }
+}
+
+void thread_pool::worker_loop( size_t worker )
+{
+    current_worker = worker;
+    std::unique_lock< std::mutex > l{ m_mutex };
+
+    while( true )
+    {
+        job* j{ nullptr };
+        m_cv.wait( l, [ & ]{ return m_stop || ( j = find_job() ) != nullptr; } );
+
+        if( m_stop )
+        {
+            return;
+        }
+
+        help( *j, worker, l );
+    }
+}
+
+auto thread_pool::find_job( uint64_t min_serial ) const noexcept -> job*
+{
+    // the nested jobs come last and block their callers, so they go first
+    for( auto it = m_jobs.rbegin(); it != m_jobs.rend() && ( *it )->serial > min_serial; ++it )
+    {
+        if( ( *it )->next_task < ( *it )->tasks_num )
+        {
+            return *it;
+        }
+    }
+
+    return nullptr;
+}
+
+void thread_pool::help( job& j, size_t worker, std::unique_lock< std::mutex >& l )
+{
+    ++j.runners;
+    l.unlock();
+
+    run_tasks( j, worker );
+
+    l.lock();
+    if( --j.runners == 0 )
+    {
+        m_cv.notify_all();
+    }
+}
+
+void thread_pool::run_tasks( job& j, size_t worker ) noexcept
+{
+    for( size_t task{ j.next_task++ }; task < j.tasks_num; task = j.next_task++ )
+    {
+        try
+        {
+            ( *j.func )( worker, task );
+        }
+        catch( ... )
+        {
+            std::lock_guard< std::mutex > l{ j.error_mutex };
+            if( !j.error )
+            {
+                j.error = std::current_exception();
+            }
+
+            // skip the rest of the tasks
+            j.next_task = j.tasks_num;
+        }
+    }
+}
+
+}// _detail
+
+}// ecs
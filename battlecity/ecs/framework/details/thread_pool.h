@@ -0,0 +1,78 @@
+#ifndef ECS_THREAD_POOL_H
+#define ECS_THREAD_POOL_H
+
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace ecs
+{
+
+namespace _detail
+{
+
+// Fixed set of worker threads executing parallel_for() jobs.
+// The calling thread takes part in each job as worker 0, a worker calling parallel_for()
+// from inside a task keeps its index. Idle workers take the tasks of the latest job first
+class thread_pool final
+{
+public:
+    using task_func = std::function< void( size_t worker, size_t task ) >;
+
+    // workers_num includes the calling thread, 0 stands for the hardware concurrency
+    explicit thread_pool( size_t workers_num = 0 );
+    thread_pool( const thread_pool& ) = delete;
+    thread_pool& operator=( const thread_pool& ) = delete;
+    ~thread_pool();
+
+    size_t get_workers_num() const noexcept;
+
+    // Calls func for each task in [ 0, tasks_num ) and blocks until all of them are done.
+    // The first exception thrown by func is rethrown once the job is finished.
+    // Nested calls from inside func are shared with the idle workers as well, the waiting
+    // caller runs the tasks of the jobs submitted after its own one meanwhile( e.g. nested in them )
+    void parallel_for( size_t tasks_num, const task_func& func );
+
+private:
+    struct job
+    {
+        const task_func* func{ nullptr };
+        size_t tasks_num{ 0 };
+        std::atomic< size_t > next_task{ 0 };
+        uint64_t serial{ 0 }; // submission number
+        size_t runners{ 0 }; // threads running the tasks, guarded by m_mutex
+        std::exception_ptr error;
+        std::mutex error_mutex;
+    };
+
+    void worker_loop( size_t worker );
+
+    // Job submitted after min_serial with the tasks nobody has taken yet, should be called under m_mutex
+    job* find_job( uint64_t min_serial = 0 ) const noexcept;
+
+    // Runs the tasks of the job found under the lock, which is released meanwhile
+    void help( job& j, size_t worker, std::unique_lock< std::mutex >& l );
+    static void run_tasks( job& j, size_t worker ) noexcept;
+
+private:
+    std::vector< std::thread > m_threads;
+
+    std::mutex m_submit_mutex; // one job of the outside threads at a time, they all are worker 0
+    std::mutex m_mutex;
+    std::condition_variable m_cv; // a job has been added or finished, or the pool is stopping
+
+    std::vector< job* > m_jobs; // in the order of submission
+    uint64_t m_last_serial{ 0 };
+    bool m_stop{ false };
+};
+
+}// _detail
+
+}// ecs
+
+#endif
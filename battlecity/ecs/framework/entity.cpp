@@ -9,9 +9,14 @@ entity::entity( world* world, entity_id id ) noexcept:
     m_world( world ),
     m_id( id ){}
 
-void entity::add_component_to_world( const component_id& id, component_wrapper& w )
+entity::~entity()
 {
-    m_world->add_component( *this, id, w );
+    clear_components();
+}
+
+void entity::add_component_to_world( const component_id& id )
+{
+    m_world->add_component( *this, id );
 }
 
 void entity::remove_component_from_world( const component_id& id )
@@ -19,11 +24,119 @@ void entity::remove_component_from_world( const component_id& id )
     m_world->remove_component( *this, id );
 }
 
+void entity::mark_changed( const component_id& id ) noexcept
+{
+    component_record* record{ find_record( id ) };
+    if( !record )
+    {
+        return;
+    }
+
+    record->changed_tick = get_current_tick();
+
+    // the entity may be out of any archetype or not moved to the one with the component yet
+    if( m_archetype && m_archetype->has_component( id ) )
+    {
+        m_archetype->mark_changed( m_archetype->get_column_index( id ), record->changed_tick );
+    }
+}
+
+uint64_t entity::get_current_tick() const noexcept
+{
+    return m_world->get_change_tick();
+}
+
 void entity::set_state( const entity_state& state ) noexcept
 {
     m_state = state;
 }
 
+bool entity::has_component( const component_id& id ) const noexcept
+{
+    return id < m_mask.size() && m_mask.test( id );
+}
+
+void entity::reserve_components( size_t size )
+{
+    m_components.reserve( size );
+}
+
+auto entity::find_record( const component_id& id ) const noexcept -> component_record*
+{
+    auto it = std::lower_bound( m_components.begin(), m_components.end(), id, component_slot::less );
+
+    return it != m_components.end() && it->id == id ? it->record : nullptr;
+}
+
+auto entity::create_record( const component_id& id ) -> component_record&
+{
+    auto it = std::lower_bound( m_components.begin(), m_components.end(), id, component_slot::less );
+
+    if( it == m_components.end() || it->id != id )
+    {
+        // only the slots are moved, the records themselves stay in place
+        it = m_components.insert( it, component_slot{ id, nullptr } );
+
+        try
+        {
+            it->record = m_world->m_component_records.create();
+        }
+        catch( ... )
+        {
+            m_components.erase( it );
+            throw;
+        }
+    }
+
+    return *it->record;
+}
+
+void entity::destroy_record( const component_id& id ) noexcept
+{
+    auto it = std::lower_bound( m_components.begin(), m_components.end(), id, component_slot::less );
+
+    if( it != m_components.end() && it->id == id )
+    {
+        m_world->m_component_records.destroy( it->record );
+        m_components.erase( it );
+    }
+}
+
+void entity::clear_components() noexcept
+{
+    for( const component_slot& slot : m_components )
+    {
+        m_world->m_component_records.destroy( slot.record );
+    }
+
+    m_components.clear();
+}
+
+const component_mask& entity::get_mask() const noexcept
+{
+    return m_mask;
+}
+
+auto entity::get_record( const component_id& id ) -> component_record&
+{
+    if( !has_component( id ) )
+    {
+        throw std::out_of_range{ "Entity doesn't have the component" };
+    }
+
+    return *find_record( id );
+}
+
+auto entity::get_record( const component_id& id ) const -> const component_record&
+{
+    if( !has_component( id ) )
+    {
+        throw std::out_of_range{ "Entity doesn't have the component" };
+    }
+
+    return *find_record( id );
+}
+
 const entity_state& entity::get_state() const noexcept
 {
     return m_state;
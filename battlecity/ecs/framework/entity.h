@@ -1,17 +1,17 @@
 #ifndef ENTITY_H
 #define ENTITY_H
 
+#include <new>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include <type_traits>
-#include <unordered_map>
 
 #include "id_engine.h"
+#include "archetype.h"
 #include "details/polymorph.h"
-
-#ifdef ECS_LOCK_ATOMIC
-#include "details/atomic_locks.h"
-#elif ECS_LOCK_MUTEX
-#include "details/rw_lock.h"
-#endif
+#include "details/lock_policy.h"
 
 #if __cplusplus < 199711L
   #error This library needs at least a C++11 compliant compiler
@@ -30,22 +30,45 @@ namespace ecs
 
 class world;
 
-using entity_id = numeric_id;
 enum class entity_state{ ok, invalid };
 
-class entity final
-        #ifdef ECS_LOCK_ATOMIC
-        : public rw_spinlock
-        #elif ECS_LOCK_MUTEX
-        : public rw_lock
-        #endif
+// Lock guarding the component set of an entity
+#ifdef ECS_LOCK_ATOMIC
+using entity_lock = use_lock< rw_spinlock >;
+#elif ECS_LOCK_MUTEX
+using entity_lock = use_lock< rw_lock >;
+#else
+using entity_lock = no_lock;
+#endif
+
+class entity final : public entity_lock
 {
     friend class world;
     using component_id = type_id;
     using component_wrapper = polymorph;
 
+    // Allocated by the world and never moved, so the components stored inline keep their addresses
+    struct component_record
+    {
+        component_wrapper wrapper;
+        void* data{ nullptr }; // component address referenced by the archetype columns
+        uint64_t changed_tick{ 0 }; // see get_component_mut()
+    };
+
+    struct component_slot
+    {
+        component_id id;
+        component_record* record;
+
+        static bool less( const component_slot& slot, const component_id& id ) noexcept
+        {
+            return slot.id < id;
+        }
+    };
+
 public:
     entity() = default;
+    ~entity();
     entity( const entity& ) = delete;
     entity( entity&& ) = delete;
     entity& operator=( const entity& ) = delete;
@@ -54,58 +77,100 @@ public:
     template< typename component_type, typename... constructor_args >
     void add_component( constructor_args&&... args )
     {
-        auto component = std::make_unique< component_type >( std::forward< constructor_args >( args )... );
         component_id id{ get_type_id< component_type >() };
 
-        auto result = m_components.emplace( id, std::move( component ) );
-        add_component_to_world( id, result.first->second );
+        if( !has_component( id ) )
+        {
+            component_record& record = create_record( id );
+
+            try
+            {
+                record.data = &record.wrapper.emplace< component_type >( std::forward< constructor_args >( args )... );
+            }
+            catch( ... )
+            {
+                destroy_record( id );
+                throw;
+            }
+
+            record.changed_tick = get_current_tick();
+            m_mask.set( id );
+
+            add_component_to_world( id );
+        }
     }
 
     template< typename component_type >
-    bool has_component() const
+    bool has_component() const noexcept
     {
-        return ( m_components.count( get_type_id< component_type >() ) != 0 );
+        return has_component( get_type_id< component_type >() );
     }
 
-    template< typename component >
+    template< typename... components >
     bool has_components() const
     {
-        return has_component< component >();
+        const component_mask& mask = get_component_mask< components... >();
+        return ( m_mask & mask ) == mask;
     }
 
-    template< typename component, typename other_component, typename... tail >
-    bool has_components() const
-    {
-        return has_component< component >()?
-               has_components< other_component, tail... >() : false;
-    }
+    const component_mask& get_mask() const noexcept;
 
     template< typename component_type >
     component_type& get_component()
     {
-        component_wrapper& ch = m_components.at( get_type_id< component_type >() );
-        return *ch.get< std::unique_ptr< component_type > >();
+        component_wrapper& ch = get_record( get_type_id< component_type >() ).wrapper;
+        return ch.get< component_type >();
     }
 
     template< typename component_type >
     const component_type& get_component() const
     {
-        const component_wrapper& ch = m_components.at( get_type_id< component_type >() );
-        return *ch.get< std::unique_ptr< component_type > >();
+        const component_wrapper& ch = get_record( get_type_id< component_type >() ).wrapper;
+        return ch.get< component_type >();
+    }
+
+    // Same as get_component(), but marks the component as changed, see world::for_each_changed_since().
+    // Call it when the component is going to be modified
+    template< typename component_type >
+    component_type& get_component_mut()
+    {
+        component_id id{ get_type_id< component_type >() };
+        component_type& component = get_record( id ).wrapper.get< component_type >();
+        mark_changed( id );
+        return component;
+    }
+
+    // Marks the component as changed if the entity has it, e.g. after modifying one passed to for_each_with()
+    template< typename component_type >
+    void mark_changed()
+    {
+        component_id id{ get_type_id< component_type >() };
+        if( has_component( id ) )
+        {
+            mark_changed( id );
+        }
+    }
+
+    // World tick of the last change of the component( world::get_change_tick() ),
+    // throws std::out_of_range if the entity doesn't have the component
+    template< typename component_type >
+    uint64_t get_changed_tick() const
+    {
+        return get_record( get_type_id< component_type >() ).changed_tick;
     }
 
     template< typename component_type >
     component_type& get_component_unsafe()
     {
-        component_wrapper& ch = m_components.at( get_type_id< component_type >() );
-        return *ch.get_unsafe< std::unique_ptr< component_type > >();
+        component_wrapper& ch = find_record( get_type_id< component_type >() )->wrapper;
+        return ch.get_unsafe< component_type >();
     }
 
     template< typename component_type >
     const component_type& get_component_unsafe() const
     {
-        const component_wrapper& ch = m_components.at( get_type_id< component_type >() );
-        return *ch.get_unsafe< std::unique_ptr< component_type > >();
+        const component_wrapper& ch = find_record( get_type_id< component_type >() )->wrapper;
+        return ch.get_unsafe< component_type >();
     }
 
     template< typename component >
@@ -167,8 +232,14 @@ public:
     void remove_component()
     {
         component_id id{ get_type_id< component_type >() };
-        m_components.erase( id );
-        remove_component_from_world( id );
+        if( has_component( id ) )
+        {
+            // the observers are notified while the component still exists
+            remove_component_from_world( id );
+
+            destroy_record( id );
+            m_mask.reset( id );
+        }
     }
 
     template< typename component >
@@ -201,8 +272,63 @@ private:
     entity( world* world, entity_id id ) noexcept;
 
     void set_state( const entity_state& state ) noexcept;
-    void add_component_to_world( const component_id& id, component_wrapper& w );
+
+    bool has_component( const component_id& id ) const noexcept;
+    void reserve_components( size_t size );
+    component_record* find_record( const component_id& id ) const noexcept;
+    component_record& create_record( const component_id& id );
+    void destroy_record( const component_id& id ) noexcept;
+    void clear_components() noexcept;
+    component_record& get_record( const component_id& id );
+    const component_record& get_record( const component_id& id ) const;
+    void add_component_to_world( const component_id& id );
     void remove_component_from_world( const component_id& id );
+    void mark_changed( const component_id& id ) noexcept; // does nothing if there's no such component
+    uint64_t get_current_tick() const noexcept;
+
+    template< typename component_type, typename args_tuple, size_t... seq >
+    void add_component_from_tuple( args_tuple&& args, const std::integer_sequence< size_t, seq... >& )
+    {
+        add_component< component_type >( std::get< seq >( std::forward< args_tuple >( args ) )... );
+    }
+
+    // Constructs the component without moving the entity to another archetype, see world::instantiate()
+    template< typename component_type, typename args_tuple, size_t... seq >
+    void emplace_component_from_tuple( args_tuple&& args, const std::integer_sequence< size_t, seq... >& )
+    {
+        component_id id{ get_type_id< component_type >() };
+        component_record& record = create_record( id );
+
+        record.data = &record.wrapper.emplace< component_type >( std::get< seq >( std::forward< args_tuple >( args ) )... );
+        record.changed_tick = get_current_tick();
+        m_mask.set( id );
+    }
+
+    // Destroys the component and constructs a new one in the same storage
+    template< typename component_type, typename args_tuple, size_t... seq >
+    void reconstruct_component_from_tuple( args_tuple&& args, const std::integer_sequence< size_t, seq... >& )
+    {
+        component_id id{ get_type_id< component_type >() };
+        component_record& record = get_record( id );
+        component_type* component{ static_cast< component_type* >( record.data ) };
+
+        component->~component_type();
+
+        try
+        {
+            new( component ) component_type( std::get< seq >( std::forward< args_tuple >( args ) )... );
+        }
+        catch( ... )
+        {
+            // the storage doesn't hold an object anymore, so it's freed without calling the destructor
+            record.wrapper.discard();
+            destroy_record( id );
+            m_mask.reset( id );
+            throw;
+        }
+
+        mark_changed( id );
+    }
 
     template< typename components_tuple, typename func_type, size_t... seq >
     bool dispatch( components_tuple& tuple,
@@ -214,9 +340,13 @@ private:
 
 private:
     world* m_world{ nullptr };
-    const entity_id m_id{ INVALID_NUMERIC_ID };
+    entity_id m_id{ INVALID_NUMERIC_ID }; // changes when a pooled entity is recycled
     entity_state m_state{ entity_state::ok };
-    std::unordered_map< component_id, component_wrapper > m_components;
+    std::vector< component_slot > m_components; // sorted by component id, only the present components
+    component_mask m_mask;
+
+    archetype* m_archetype{ nullptr };
+    size_t m_archetype_row{ 0 };
 };
 
 bool operator==( const entity& l, const entity& r ) noexcept;
@@ -1,23 +1,28 @@
 #include "id_engine.h"
-#include <random>
 
 namespace ecs
 {
 
-numeric_id generate_numeric_id()
+entity_id make_entity_id( numeric_id index, numeric_id version ) noexcept
 {
-    static std::mt19937 rng{ std::random_device{}() };
-    static std::uniform_int_distribution< std::mt19937::result_type > dist{
-                std::numeric_limits< numeric_id >::min(),
-                std::numeric_limits< numeric_id >::max() };
+    return ( entity_id{ version } << entity_index_bits ) | index;
+}
 
-    numeric_id id = dist( rng );
-    while( id == INVALID_NUMERIC_ID )
-    {
-        id = dist( rng );
-    }
+numeric_id get_entity_index( entity_id id ) noexcept
+{
+    return static_cast< numeric_id >( id & entity_index_mask );
+}
 
-    return id;
+numeric_id get_entity_version( entity_id id ) noexcept
+{
+    return static_cast< numeric_id >( id >> entity_index_bits );
+}
+
+numeric_id next_entity_version( numeric_id version ) noexcept
+{
+    // 0 is skipped on overflow to keep the ids valid
+    ++version;
+    return version == 0? 1 : version;
 }
 
 }// ecs
@@ -1,22 +1,102 @@
 #ifndef ID_ENGINE_H
 #define ID_ENGINE_H
 
-#include <typeinfo>
-#include <typeindex>
+#include <bitset>
+#include <atomic>
 #include <cstdint>
 
+// Upper bound of component types, defines the size of the component masks
+#ifndef ECS_MAX_COMPONENTS
+#define ECS_MAX_COMPONENTS 64
+#endif
+
 namespace ecs
 {
 
-using type_id = std::type_index;
+// Small dense integer assigned to each component/event type,
+// suitable for indexing flat arrays instead of hashing
+using type_id = uint32_t;
 using numeric_id = uint32_t;
 
 #define INVALID_NUMERIC_ID 0
 
+// Types of different families are numbered independently
+struct component_family{};
+struct event_family{};
+struct view_family{};
+struct resource_family{};
+struct prefab_family{};
+
+namespace _detail
+{
+
+template< typename family >
+std::atomic< type_id >& type_id_counter() noexcept
+{
+    static std::atomic< type_id > counter{ 0 };
+    return counter;
+}
+
+}// _detail
+
+// The id is assigned once, on the first call for the type,
+// so every subsequent lookup boils down to reading a static variable
+template< typename type, typename family = component_family >
+type_id get_type_id() noexcept
+{
+    static const type_id id{ _detail::type_id_counter< family >()++ };
+    return id;
+}
+
 template< typename type >
-constexpr type_id get_type_id() noexcept{ return { typeid( type ) }; }
+type_id get_event_id() noexcept
+{
+    return get_type_id< type, event_family >();
+}
+
+// Number of ids assigned so far
+template< typename family = component_family >
+type_id registered_types_num() noexcept
+{
+    return _detail::type_id_counter< family >().load();
+}
+
+// Set of component types, one bit per component id
+using component_mask = std::bitset< ECS_MAX_COMPONENTS >;
+
+// Throws std::out_of_range if more than ECS_MAX_COMPONENTS component types are used
+template< typename... components >
+component_mask make_component_mask()
+{
+    component_mask mask;
+    using expander = int[];
+    (void)expander{ 0, ( mask.set( get_type_id< components >() ), 0 )... };
+    return mask;
+}
+
+// The mask is built once per set of components, so checking an entity
+// against a fixed query is a single AND of two masks
+template< typename... components >
+const component_mask& get_component_mask()
+{
+    static const component_mask mask{ make_component_mask< components... >() };
+    return mask;
+}
+
+// Entity ids are generational handles: the low half holds the index of the world's entity slot,
+// the high half holds the slot version, which is bumped each time the slot is reused.
+// A stale id could only match again after 2^32 - 1 reuses of its slot.
+// Versions start with 1, so a valid id never equals INVALID_NUMERIC_ID
+using entity_id = uint64_t;
+
+static constexpr numeric_id entity_index_bits{ 32 };
+static constexpr entity_id entity_index_mask{ ( entity_id{ 1 } << entity_index_bits ) - 1 };
+static constexpr entity_id max_entities_num{ entity_index_mask + 1 };
 
-numeric_id generate_numeric_id();
+entity_id make_entity_id( numeric_id index, numeric_id version ) noexcept;
+numeric_id get_entity_index( entity_id id ) noexcept;
+numeric_id get_entity_version( entity_id id ) noexcept;
+numeric_id next_entity_version( numeric_id version ) noexcept;
 
 }// ecs
 
@@ -0,0 +1,23 @@
+#ifndef ECS_PREFAB_H
+#define ECS_PREFAB_H
+
+#include "id_engine.h"
+
+namespace ecs
+{
+
+// Describes the set of components an entity is made of, see world::instantiate() and world::recycle_or_create()
+template< typename... components >
+struct prefab final
+{
+    static_assert( sizeof...( components ) > 0, "Prefab should contain at least one component" );
+
+    static const component_mask& get_mask()
+    {
+        return get_component_mask< components... >();
+    }
+};
+
+}// ecs
+
+#endif
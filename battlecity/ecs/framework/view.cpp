@@ -0,0 +1,113 @@
+#include "view.h"
+
+namespace ecs
+{
+
+view_iterator::view_iterator( archetype* const* current, archetype* const* end ) noexcept :
+    m_current( current ),
+    m_end( end )
+{
+    skip_empty();
+}
+
+entity& view_iterator::operator*() const noexcept
+{
+    return ( *m_current )->get_entity( m_row );
+}
+
+entity* view_iterator::operator->() const noexcept
+{
+    return &**this;
+}
+
+view_iterator& view_iterator::operator++() noexcept
+{
+    ++m_row;
+    skip_empty();
+    return *this;
+}
+
+view_iterator view_iterator::operator++( int ) noexcept
+{
+    view_iterator prev{ *this };
+    ++*this;
+    return prev;
+}
+
+bool view_iterator::operator==( const view_iterator& other ) const noexcept
+{
+    return m_current == other.m_current && m_row == other.m_row;
+}
+
+bool view_iterator::operator!=( const view_iterator& other ) const noexcept
+{
+    return !( *this == other );
+}
+
+void view_iterator::skip_empty() noexcept
+{
+    while( m_current != m_end && m_row >= ( *m_current )->size() )
+    {
+        ++m_current;
+        m_row = 0;
+    }
+}
+
+namespace _detail
+{
+
+view_base::view_base( const component_mask& mask ) :
+    m_mask( mask ){}
+
+const component_mask& view_base::get_mask() const noexcept
+{
+    return m_mask;
+}
+
+view_iterator view_base::begin() const noexcept
+{
+    return { m_archetypes.data(), m_archetypes.data() + m_archetypes.size() };
+}
+
+view_iterator view_base::end() const noexcept
+{
+    archetype* const* end{ m_archetypes.data() + m_archetypes.size() };
+    return { end, end };
+}
+
+size_t view_base::size() const noexcept
+{
+    size_t size{ 0 };
+    for( archetype* a : m_archetypes )
+    {
+        size += a->size();
+    }
+
+    return size;
+}
+
+bool view_base::empty() const noexcept
+{
+    for( archetype* a : m_archetypes )
+    {
+        if( !a->empty() )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void view_base::try_add_archetype( archetype& a )
+{
+    if( a.has_components( m_mask ) )
+    {
+        m_archetypes.emplace_back( &a );
+        on_archetype_added( a );
+    }
+}
+
+}// _detail
+
+}// ecs
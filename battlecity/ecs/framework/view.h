@@ -0,0 +1,176 @@
+#ifndef ECS_VIEW_H
+#define ECS_VIEW_H
+
+#include <array>
+#include <vector>
+#include <iterator>
+
+#include "entity.h"
+
+namespace ecs
+{
+
+class world;
+
+// Forward iterator over the entities of the archetypes matched by a view.
+// Walks the archetypes row by row, nothing is copied or allocated
+class view_iterator final
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = entity;
+    using difference_type = std::ptrdiff_t;
+    using pointer = entity*;
+    using reference = entity&;
+
+    view_iterator() = default;
+    view_iterator( archetype* const* current, archetype* const* end ) noexcept;
+
+    entity& operator*() const noexcept;
+    entity* operator->() const noexcept;
+
+    view_iterator& operator++() noexcept;
+    view_iterator operator++( int ) noexcept;
+
+    bool operator==( const view_iterator& other ) const noexcept;
+    bool operator!=( const view_iterator& other ) const noexcept;
+
+private:
+    void skip_empty() noexcept;
+
+private:
+    archetype* const* m_current{ nullptr };
+    archetype* const* m_end{ nullptr };
+    size_t m_row{ 0 };
+};
+
+namespace _detail
+{
+
+// Type independent part of a view: the list of archetypes matching the mask
+class view_base
+{
+    friend class ecs::world;
+
+public:
+    explicit view_base( const component_mask& mask );
+    view_base( const view_base& ) = delete;
+    view_base& operator=( const view_base& ) = delete;
+    virtual ~view_base() = default;
+
+    const component_mask& get_mask() const noexcept;
+
+    // Contains the entities scheduled to be removed as well, so check the state if needed
+    view_iterator begin() const noexcept;
+    view_iterator end() const noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+protected:
+    virtual void on_archetype_added( archetype& a ) = 0;
+
+private:
+    // Called by the world for each archetype created
+    void try_add_archetype( archetype& a );
+
+protected:
+    component_mask m_mask;
+    std::vector< archetype* > m_archetypes;
+};
+
+}// _detail
+
+// Persistent query owned by the world, see world::view().
+// Archetypes matching the query are cached once they are created, while entities
+// move between the archetypes on their own, so the view never needs to be rebuilt
+template< typename component_type, typename... other_components >
+class query_view final : public _detail::view_base
+{
+    using columns = std::array< size_t, 1 + sizeof...( other_components ) >;
+
+public:
+    query_view() :
+        view_base( get_component_mask< component_type, other_components... >() ){}
+
+    // func should be of signature bool< entity&, component_type_1&, ..., component_type_n&.... >
+    // where bool indicates whether the loop should continue execution upon function return
+    template< typename func_type >
+    void for_each( func_type&& func )
+    {
+        // archetypes may be created by func, so the list is accessed by index
+        for( size_t i{ 0 }; i < m_archetypes.size(); ++i )
+        {
+            archetype& a = *m_archetypes[ i ];
+            const columns& c = m_columns[ i ];
+
+            for( size_t row{ 0 }; row < a.size(); ++row )
+            {
+                entity& e = a.get_entity( row );
+
+                if( e.get_state() == entity_state::ok &&
+                    !func( e,
+                           *static_cast< component_type* >( a.get_component( row, c[ 0 ] ) ),
+                           *static_cast< other_components* >(
+                               a.get_component( row, c[ column_of< other_components >() ] ) )... ) )
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    // Same as for_each(), but only visits the entities whose component_type
+    // has been changed after the tick, see world::for_each_changed_since()
+    template< typename func_type >
+    void for_each_changed_since( uint64_t tick, func_type&& func )
+    {
+        for( size_t i{ 0 }; i < m_archetypes.size(); ++i )
+        {
+            archetype& a = *m_archetypes[ i ];
+            const columns& c = m_columns[ i ];
+
+            if( a.get_changed_tick( c[ 0 ] ) <= tick )
+            {
+                continue;
+            }
+
+            for( size_t row{ 0 }; row < a.size(); ++row )
+            {
+                entity& e = a.get_entity( row );
+
+                if( e.get_state() == entity_state::ok &&
+                    e.get_changed_tick< component_type >() > tick &&
+                    !func( e,
+                           *static_cast< component_type* >( a.get_component( row, c[ 0 ] ) ),
+                           *static_cast< other_components* >(
+                               a.get_component( row, c[ column_of< other_components >() ] ) )... ) )
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+protected:
+    void on_archetype_added( archetype& a ) override
+    {
+        m_columns.emplace_back( columns{ {
+                a.get_column_index( get_type_id< component_type >() ),
+                a.get_column_index( get_type_id< other_components >() )... } } );
+    }
+
+private:
+    template< typename type >
+    static constexpr size_t column_of() noexcept
+    {
+        return _detail::type_position< type, component_type, other_components... >::value;
+    }
+
+private:
+    std::vector< columns > m_columns; // parallel to m_archetypes
+};
+
+}// ecs
+
+#endif
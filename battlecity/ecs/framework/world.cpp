@@ -3,25 +3,173 @@
 namespace ecs
 {
 
-entity_id generate_entity_id( const std::unordered_map< entity_id, std::unique_ptr< entity > >& present_entries )
+namespace
 {
-    numeric_id id{ generate_numeric_id() };
-    while( present_entries.count( id ) )
+
+// Everything a system may touch during its tick, including the handlers of the events it emits
+struct effective_access
+{
+    component_mask reads;
+    component_mask writes;
+    std::vector< const system* > handlers; // systems whose handlers are called, sorted
+    bool external{ false }; // calls handlers that aren't systems
+    bool exclusive{ false };
+};
+
+bool intersect( const std::vector< const system* >& l, const std::vector< const system* >& r ) noexcept
+{
+    auto l_it = l.begin();
+    auto r_it = r.begin();
+
+    while( l_it != l.end() && r_it != r.end() )
     {
-        id = generate_numeric_id();
+        if( *l_it == *r_it )
+        {
+            return true;
+        }
+
+        *l_it < *r_it? ++l_it : ++r_it;
     }
 
-    return id;
+    return false;
+}
+
+bool contains( const std::vector< const system* >& systems, const system* s ) noexcept
+{
+    return std::binary_search( systems.begin(), systems.end(), s );
+}
+
+bool conflict( const system* l, const effective_access& l_access,
+               const system* r, const effective_access& r_access ) noexcept
+{
+    return l_access.exclusive || r_access.exclusive ||
+           ( l_access.writes & ( r_access.reads | r_access.writes ) ).any() ||
+           ( r_access.writes & l_access.reads ).any() ||
+           ( l_access.external && r_access.external ) ||
+           contains( l_access.handlers, r ) ||
+           contains( r_access.handlers, l ) ||
+           intersect( l_access.handlers, r_access.handlers );
+}
+
+}
+
+namespace _detail
+{
+
+void entity_callbacks_table::add( type_id event, entity_id entity, event_callback_base* callback )
+{
+    std::lock_guard< std::mutex > l{ m_mutex };
+
+    if( event >= m_callbacks.size() )
+    {
+        m_callbacks.resize( event + 1 );
+        m_routed.resize( event + 1, false );
+    }
+
+    m_callbacks[ event ][ entity ].emplace_back( callback );
+    m_count.fetch_add( 1, std::memory_order_release );
+
+    if( !m_routed[ event ] )
+    {
+        m_routed[ event ] = true;
+        m_new_events.store( true, std::memory_order_release );
+    }
+}
+
+void entity_callbacks_table::remove( type_id event, entity_id entity, event_callback_base* callback )
+{
+    std::lock_guard< std::mutex > l{ m_mutex };
+
+    if( event >= m_callbacks.size() )
+    {
+        return;
+    }
+
+    auto it = m_callbacks[ event ].find( entity );
+    if( it == m_callbacks[ event ].end() )
+    {
+        return;
+    }
+
+    std::vector< event_callback_base* >& callbacks = it->second;
+    auto callback_it = std::find( callbacks.begin(), callbacks.end(), callback );
+    if( callback_it != callbacks.end() )
+    {
+        callbacks.erase( callback_it );
+        m_count.fetch_sub( 1, std::memory_order_release );
+    }
+
+    if( callbacks.empty() )
+    {
+        m_callbacks[ event ].erase( it );
+    }
+}
+
+bool entity_callbacks_table::is_routed( type_id event ) const
+{
+    std::lock_guard< std::mutex > l{ m_mutex };
+    return event < m_routed.size() && m_routed[ event ];
+}
+
+bool entity_callbacks_table::take_new_events() noexcept
+{
+    return m_new_events.load( std::memory_order_acquire ) && m_new_events.exchange( false, std::memory_order_acq_rel );
 }
 
+}// _detail
+
 bool world::tick()
 {
+    dispatch_input();
     cleanup();
+
+    // the systems emitting the events of a new type start calling non-system callbacks
+    if( m_entity_callbacks.take_new_events() )
+    {
+        m_schedule_dirty = true;
+    }
+
+    if( m_schedule_dirty )
+    {
+        build_schedule();
+    }
+
     bool result{ true };
+    size_t system_order{ 0 }; // position in the schedule, orders the recorded commands
 
-    for( system* system : m_systems )
+    for( const std::vector< system* >& group : m_schedule )
     {
-        result = system->tick();
+        m_change_tick.fetch_add( 1, std::memory_order_relaxed );
+
+        if( group.size() == 1 )
+        {
+            _detail::command_order_scope order{ _detail::command_order{ system_order, 0 } };
+            result = group.front()->tick();
+        }
+        else
+        {
+            std::atomic< bool > group_result{ true };
+            get_thread_pool().parallel_for( group.size(), [ & ]( size_t, size_t i )
+            {
+                _detail::command_order_scope order{ _detail::command_order{ system_order + i, 0 } };
+                if( !group[ i ]->tick() )
+                {
+                    group_result = false;
+                }
+            } );
+
+            result = group_result;
+        }
+
+        system_order += group.size();
+
+        // changes made after the group are newer than the tick its systems have started at
+        m_change_tick.fetch_add( 1, std::memory_order_relaxed );
+
+        // queued events are delivered before the commands remove the entities they refer to
+        dispatch_events();
+        play_commands();
+
         if( !result )
         {
             break;
@@ -33,9 +181,11 @@ bool world::tick()
 
 void world::reset()
 {
-    m_entities.clear();
-    m_components.clear();
-    m_entities_to_remove.clear();
+    clear_entities();
+    clear_archetypes();
+    m_resources.clear();
+    discard_events();
+    discard_commands();
     m_systems_to_remove.clear();
 
     for( system* system : m_systems )
@@ -46,67 +196,281 @@ void world::reset()
 
 void world::clean()
 {
-    m_entities.clear();
-    m_components.clear();
+    clear_entities();
+    clear_archetypes();
+    m_resources.clear();
+    m_entity_pools.clear();
     m_systems.clear();
-    m_entities_to_remove.clear();
+    m_schedule.clear();
+    m_schedule_dirty = true;
+    discard_events();
+    discard_commands();
     m_systems_to_remove.clear();
 }
 
 entity& world::create_entity()
 {
-    entity_id id{ generate_entity_id( m_entities ) };
-    std::unique_ptr< entity > e{ new entity{ this, id } };
-    auto res = m_entities.emplace( id, std::move( e ) );
-    return *res.first->second;
+    return insert_entity( std::unique_ptr< entity >{ new entity{ this, INVALID_NUMERIC_ID } } );
+}
+
+entity& world::insert_entity( std::unique_ptr< entity > e )
+{
+    numeric_id index{ 0 };
+    if( !m_free_entity_slots.empty() )
+    {
+        index = m_free_entity_slots.back();
+        m_free_entity_slots.pop_back();
+    }
+    else
+    {
+        if( m_entity_slots.size() >= max_entities_num )
+        {
+            throw std::length_error{ "Entities limit exceeded" };
+        }
+
+        index = static_cast< numeric_id >( m_entity_slots.size() );
+        m_entity_slots.emplace_back();
+    }
+
+    entity_slot& slot = m_entity_slots[ index ];
+    slot.version = next_entity_version( slot.version );
+
+    e->m_id = make_entity_id( index, slot.version );
+    e->m_state = entity_state::ok;
+    slot.e = std::move( e );
+
+    return *slot.e;
 }
 
 bool world::entity_present( entity_id id ) const noexcept
 {
-    return ( m_entities.count( id ) != 0 );
+    numeric_id index{ get_entity_index( id ) };
+    return index < m_entity_slots.size() &&
+           m_entity_slots[ index ].e &&
+           m_entity_slots[ index ].e->get_id() == id;
 }
 
 entity& world::get_entity( entity_id id )
 {
-    return *m_entities.at( id );
+    if( !entity_present( id ) )
+    {
+        throw std::out_of_range{ "Entity is not present" };
+    }
+
+    return *m_entity_slots[ get_entity_index( id ) ].e;
 }
 
 void world::remove_entity( entity& e )
 {
-    for( const auto& component_info : e.m_components )
+    notify_observers( e, observer_kind::removed );
+    release_entity( e, find_pool( e.m_mask ) );
+}
+
+void world::remove_entity( entity_id id )
+{
+    remove_entity( get_entity( id ) );
+}
+
+void world::destroy_entities( const std::vector< entity_id >& ids )
+{
+    m_free_entity_slots.reserve( m_free_entity_slots.size() + ids.size() );
+
+    component_mask pool_mask;
+    entity_pool* pool{ nullptr };
+    bool pool_found{ false };
+
+    for( entity_id id : ids )
     {
-        remove_component( e, component_info.first );
+        if( !entity_present( id ) )
+        {
+            continue;
+        }
+
+        entity& e = *m_entity_slots[ get_entity_index( id ) ].e;
+        notify_observers( e, observer_kind::removed );
+
+        if( !pool_found || pool_mask != e.m_mask )
+        {
+            pool_mask = e.m_mask;
+            pool = find_pool( pool_mask );
+            pool_found = true;
+        }
+
+        release_entity( e, pool );
     }
+}
 
-    m_entities.erase( e.get_id() );
+void world::destroy_all_with( const type_id& component )
+{
+    std::vector< entity* > entities;
+
+    // archetypes may be created by the observers, so the list is accessed by index
+    for( size_t i{ 0 }; i < m_archetypes_list.size(); ++i )
+    {
+        archetype& a = *m_archetypes_list[ i ];
+        if( a.empty() || !a.has_component( component ) )
+        {
+            continue;
+        }
+
+        entities.assign( a.get_entities(), a.get_entities() + a.size() );
+        for( entity* e : entities )
+        {
+            notify_observers( *e, observer_kind::removed );
+        }
+
+        entity_pool* pool{ find_pool( a.get_mask() ) };
+        m_free_entity_slots.reserve( m_free_entity_slots.size() + entities.size() );
+
+        // removing from the back doesn't move the other rows
+        for( auto it = entities.rbegin(); it != entities.rend(); ++it )
+        {
+            release_entity( **it, pool );
+        }
+    }
 }
 
-void world::remove_entity( entity_id id )
+void world::reserve_entities( size_t count )
+{
+    if( count > m_free_entity_slots.size() )
+    {
+        m_entity_slots.reserve( m_entity_slots.size() + count - m_free_entity_slots.size() );
+    }
+}
+
+void world::release_entity( entity& e, entity_pool* pool )
+{
+    numeric_id index{ get_entity_index( e.get_id() ) };
+
+    detach_entity( e );
+
+    // the entity keeps its components until it's recycled
+    std::unique_ptr< entity >& slot_entity = m_entity_slots[ index ].e;
+    if( pool )
+    {
+        pool->entities.emplace_back( std::move( slot_entity ) );
+    }
+
+    slot_entity.reset();
+    m_free_entity_slots.emplace_back( index );
+}
+
+auto world::find_pool( const component_mask& mask ) -> entity_pool*
 {
-    entity& e = *m_entities.at( id );
-    remove_entity( e );
+    if( m_entity_pools.empty() )
+    {
+        return nullptr;
+    }
+
+    auto it = m_entity_pools.find( mask );
+    return it != m_entity_pools.end()? &it->second : nullptr;
 }
 
 void world::schedule_remove_entity( entity& e )
 {
     e.set_state( entity_state::invalid );
-    m_entities_to_remove.emplace( &e );
+    get_command_buffer().destroy_entity( e.get_id() );
 }
 
 void world::schedule_remove_entity( entity_id id )
 {
-    schedule_remove_entity( *m_entities.at( id ) );
+    schedule_remove_entity( get_entity( id ) );
+}
+
+command_buffer& world::get_command_buffer()
+{
+    struct cached_buffer
+    {
+        uint64_t world_serial{ 0 };
+        command_buffer* buffer{ nullptr };
+    };
+
+    // the last buffer used by the thread, so that the registry is only locked once
+    static thread_local cached_buffer cache;
+    if( cache.world_serial == m_serial )
+    {
+        return *cache.buffer;
+    }
+
+    std::lock_guard< std::mutex > l{ m_command_buffers_mutex };
+
+    std::unique_ptr< command_buffer >& buffer = m_command_buffers[ std::this_thread::get_id() ];
+    if( !buffer )
+    {
+        buffer.reset( new command_buffer{} );
+        m_command_buffers_list.emplace_back( buffer.get() );
+    }
+
+    cache.world_serial = m_serial;
+    cache.buffer = buffer.get();
+
+    return *buffer;
+}
+
+void world::play_commands()
+{
+    // commands may record new ones, they're played back as well
+    while( true )
+    {
+        {
+            // the registry isn't locked during the playback, since commands may create buffers
+            std::lock_guard< std::mutex > l{ m_command_buffers_mutex };
+            for( command_buffer* buffer : m_command_buffers_list )
+            {
+                std::lock_guard< std::mutex > buffer_lock{ buffer->m_mutex };
+                std::move( buffer->m_commands.begin(), buffer->m_commands.end(), std::back_inserter( m_commands_to_play ) );
+                buffer->m_commands.clear();
+            }
+        }
+
+        if( m_commands_to_play.empty() )
+        {
+            break;
+        }
+
+        // a system runs on a single thread, so its commands come from one buffer in the recording order
+        std::stable_sort( m_commands_to_play.begin(), m_commands_to_play.end(),
+                          []( const command_buffer::command& l, const command_buffer::command& r )
+        {
+            return l.order < r.order;
+        } );
+
+        try
+        {
+            for( const command_buffer::command& c : m_commands_to_play )
+            {
+                play_command( c );
+            }
+        }
+        catch( ... )
+        {
+            m_commands_to_play.clear();
+            throw;
+        }
+
+        m_commands_to_play.clear();
+    }
 }
 
 void world::add_system( system& system )
 {
     system.init();
-    m_systems.emplace( &system );
+
+    if( std::find( m_systems.begin(), m_systems.end(), &system ) == m_systems.end() )
+    {
+        m_systems.emplace_back( &system );
+        m_schedule_dirty = true;
+    }
 }
 
 void world::remove_system( system& s )
 {
-    m_systems.erase( &s );
+    auto it = std::find( m_systems.begin(), m_systems.end(), &s );
+    if( it != m_systems.end() )
+    {
+        m_systems.erase( it );
+        m_schedule_dirty = true;
+    }
 }
 
 void world::schedule_remove_system( system& system )
@@ -114,40 +478,438 @@ void world::schedule_remove_system( system& system )
     m_systems_to_remove.emplace( &system );
 }
 
-void world::add_component( entity& e, const entity::component_id& id, entity::component_wrapper& w )
+observer_id world::add_observer( const type_id& component, observer_kind kind, component_observer observer )
+{
+    if( component >= m_observers.size() )
+    {
+        m_observers.resize( std::max< size_t >( component + 1, registered_types_num() ) );
+    }
+
+    component_observers& observers = m_observers[ component ];
+    auto& list = kind == observer_kind::added? observers.added : observers.removed;
+    list.emplace_back( ++m_last_observer_id, std::move( observer ) );
+
+    return m_last_observer_id;
+}
+
+void world::remove_observer( observer_id id )
+{
+    auto has_id = [ id ]( const std::pair< observer_id, component_observer >& observer )
+    {
+        return observer.first == id;
+    };
+
+    for( component_observers& observers : m_observers )
+    {
+        observers.added.erase( std::remove_if( observers.added.begin(), observers.added.end(), has_id ),
+                               observers.added.end() );
+        observers.removed.erase( std::remove_if( observers.removed.begin(), observers.removed.end(), has_id ),
+                                 observers.removed.end() );
+    }
+}
+
+void world::notify_observers( entity& e, const type_id& component, observer_kind kind )
+{
+    if( component >= m_observers.size() )
+    {
+        return;
+    }
+
+    component_observers& observers = m_observers[ component ];
+    auto& list = kind == observer_kind::added? observers.added : observers.removed;
+
+    // observers may add or remove other observers, so the list is accessed by index
+    for( size_t i{ 0 }; i < list.size() && e.has_component( component ); ++i )
+    {
+        component_observer observer{ list[ i ].second };
+        observer( e );
+    }
+}
+
+void world::notify_observers( entity& e, observer_kind kind )
+{
+    for( type_id component{ 0 }; component < m_observers.size(); ++component )
+    {
+        if( e.has_component( component ) )
+        {
+            notify_observers( e, component, kind );
+        }
+    }
+}
+
+_detail::resource_base& world::get_resource( const type_id& id )
+{
+    if( id >= m_resources.size() || !m_resources[ id ] )
+    {
+        throw std::out_of_range{ "Resource is not set" };
+    }
+
+    return *m_resources[ id ];
+}
+
+const _detail::resource_base& world::get_resource( const type_id& id ) const
+{
+    if( id >= m_resources.size() || !m_resources[ id ] )
+    {
+        throw std::out_of_range{ "Resource is not set" };
+    }
+
+    return *m_resources[ id ];
+}
+
+uint64_t world::get_change_tick() const noexcept
+{
+    return m_change_tick.load( std::memory_order_relaxed );
+}
+
+void world::set_workers_num( size_t workers_num )
+{
+    m_workers_num = workers_num;
+    m_thread_pool.reset();
+}
+
+size_t world::get_workers_num()
+{
+    return get_thread_pool().get_workers_num();
+}
+
+_detail::thread_pool& world::get_thread_pool()
+{
+    if( !m_thread_pool )
+    {
+        m_thread_pool.reset( new _detail::thread_pool{ m_workers_num } );
+    }
+
+    return *m_thread_pool;
+}
+
+void world::add_component( entity& e, const entity::component_id& id )
 {
-    m_components[ id ].emplace( &e, &w );
+    archetype* from{ e.m_archetype };
+    archetype* to{ from? from->get_add_edge( id ) : nullptr };
+
+    if( !to )
+    {
+        component_mask mask{ e.m_mask };
+        to = &get_archetype( mask.set( id ) );
+
+        if( from )
+        {
+            from->set_add_edge( id, *to );
+            to->set_remove_edge( id, *from );
+        }
+    }
+
+    move_entity( e, to );
+    notify_observers( e, id, observer_kind::added );
 }
 
 void world::remove_component( entity& e, const entity::component_id& id )
 {
-    auto it = m_components.find( id );
-    if( it !=  m_components.end() )
+    archetype* from{ e.m_archetype };
+    if( !from || !from->has_component( id ) )
+    {
+        return;
+    }
+
+    notify_observers( e, id, observer_kind::removed );
+
+    archetype* to{ from->get_remove_edge( id ) };
+    if( !to && from->get_signature().size() > 1 )
     {
-        it->second.erase( &e );
-        if( it->second.empty() )
+        component_mask mask{ e.m_mask };
+        to = &get_archetype( mask.reset( id ) );
+
+        from->set_remove_edge( id, *to );
+        to->set_add_edge( id, *from );
+    }
+
+    move_entity( e, to );
+}
+
+archetype& world::get_archetype( const component_mask& mask )
+{
+    auto it = m_archetypes.find( mask );
+    if( it == m_archetypes.end() )
+    {
+        std::unique_ptr< archetype > a{ new archetype{ mask } };
+        m_archetypes_list.emplace_back( a.get() );
+        it = m_archetypes.emplace( mask, std::move( a ) ).first;
+
+        for( auto& view : m_views )
         {
-            m_components.erase( it );
+            if( view )
+            {
+                view->try_add_archetype( *it->second );
+            }
         }
     }
+
+    return *it->second;
 }
 
-void world::cleanup()
+archetype& world::get_prefab_archetype( const type_id& prefab, const component_mask& mask )
+{
+    if( prefab >= m_prefab_archetypes.size() )
+    {
+        m_prefab_archetypes.resize( std::max< size_t >( prefab + 1, registered_types_num< prefab_family >() ), nullptr );
+    }
+
+    archetype*& a = m_prefab_archetypes[ prefab ];
+    if( !a )
+    {
+        a = &get_archetype( mask );
+    }
+
+    return *a;
+}
+
+void world::move_entity( entity& e, archetype* to )
+{
+    detach_entity( e );
+
+    if( to )
+    {
+        size_t row{ to->add_entity( e ) };
+        const component_signature& signature = to->get_signature();
+        auto slot = e.m_components.begin();
+
+        for( size_t column{ 0 }; column < signature.size(); ++column )
+        {
+            // both are sorted by component id, the entity may still hold a component being removed
+            while( slot->id != signature[ column ] )
+            {
+                ++slot;
+            }
+
+            const entity::component_record& record = *slot->record;
+            to->set_component( row, column, record.data );
+            to->mark_changed( column, record.changed_tick );
+        }
+
+        e.m_archetype = to;
+        e.m_archetype_row = row;
+    }
+}
+
+void world::detach_entity( entity& e ) noexcept
+{
+    if( e.m_archetype )
+    {
+        entity* moved{ e.m_archetype->remove_entity( e.m_archetype_row ) };
+        if( moved )
+        {
+            moved->m_archetype_row = e.m_archetype_row;
+        }
+
+        e.m_archetype = nullptr;
+        e.m_archetype_row = 0;
+    }
+}
+
+void world::clear_entities()
+{
+    // versions are kept, so the handles of the removed entities stay invalid
+    m_free_entity_slots.clear();
+    for( numeric_id index{ static_cast< numeric_id >( m_entity_slots.size() ) }; index > 0; --index )
+    {
+        m_entity_slots[ index - 1 ].e.reset();
+        m_free_entity_slots.emplace_back( index - 1 );
+    }
+}
+
+void world::clear_archetypes() noexcept
 {
-    for( entity* e : m_entities_to_remove )
+    for( archetype* a : m_archetypes_list )
     {
-        remove_entity( *e );
+        a->clear();
     }
+}
+
+void world::dispatch_events()
+{
+    bool dispatched{ true };
+    while( dispatched )
+    {
+        dispatched = false;
+
+        for( size_t id{ 0 }; id < m_event_queues.size(); ++id )
+        {
+            if( m_event_queues[ id ] && m_event_queues[ id ]->dispatch( id, m_subscribers[ id ].callbacks, m_entity_callbacks ) )
+            {
+                dispatched = true;
+            }
+        }
+    }
+}
+
+void world::dispatch_input()
+{
+    for( size_t id{ 0 }; id < m_input_queues.size(); ++id )
+    {
+        if( m_input_queues[ id ] )
+        {
+            m_input_queues[ id ]->dispatch( id, m_subscribers[ id ].callbacks, m_entity_callbacks );
+        }
+    }
+}
+
+void world::cleanup()
+{
+    dispatch_events();
+    play_commands();
 
     for( system* s : m_systems_to_remove )
     {
-        m_systems.erase( s );
+        remove_system( *s );
     }
 
-    m_entities_to_remove.clear();
     m_systems_to_remove.clear();
 }
 
+void world::play_command( const command_buffer::command& c )
+{
+    if( c.type == command_buffer::command_type::create )
+    {
+        entity& e = c.create? c.create( *this ) : create_entity();
+        if( c.func )
+        {
+            c.func( e );
+        }
+    }
+    else if( entity_present( c.id ) )
+    {
+        entity& e = *m_entity_slots[ get_entity_index( c.id ) ].e;
+        if( c.type == command_buffer::command_type::destroy )
+        {
+            remove_entity( e );
+        }
+        else
+        {
+            c.func( e );
+        }
+    }
+}
+
+void world::discard_events()
+{
+    for( auto& queue : m_input_queues )
+    {
+        if( queue )
+        {
+            queue->clear();
+        }
+    }
+
+    for( auto& queue : m_event_queues )
+    {
+        if( queue )
+        {
+            queue->clear();
+        }
+    }
+}
+
+void world::discard_commands()
+{
+    std::lock_guard< std::mutex > l{ m_command_buffers_mutex };
+    for( command_buffer* buffer : m_command_buffers_list )
+    {
+        std::lock_guard< std::mutex > buffer_lock{ buffer->m_mutex };
+        buffer->m_commands.clear();
+    }
+}
+
+void world::build_schedule()
+{
+    std::vector< effective_access > accesses( m_systems.size() );
+
+    for( size_t i{ 0 }; i < m_systems.size(); ++i )
+    {
+        const system::access& declared = m_systems[ i ]->m_access;
+        effective_access& access = accesses[ i ];
+        access.reads = declared.reads;
+        access.writes = declared.writes;
+        access.exclusive = !declared.declared || declared.changes_structure;
+
+        // follow the events emitted by the system and by the handlers of those events
+        std::vector< type_id > events{ declared.emits };
+        std::unordered_set< type_id > visited_events;
+
+        while( !events.empty() )
+        {
+            type_id event{ events.back() };
+            events.pop_back();
+
+            // handlers of the queued events are called at the sync points
+            bool queued{ event < m_event_queues.size() && m_event_queues[ event ] };
+            if( queued || !visited_events.emplace( event ).second )
+            {
+                continue;
+            }
+
+            access.external = access.external || m_entity_callbacks.is_routed( event );
+            if( event >= m_subscribers.size() )
+            {
+                continue;
+            }
+
+            const event_subscribers& subscribers = m_subscribers[ event ];
+            access.external = access.external || subscribers.callbacks.size() > subscribers.systems.size();
+
+            for( const system* handler : subscribers.systems )
+            {
+                const system::access& handler_access = handler->m_access;
+                access.reads |= handler_access.reads;
+                access.writes |= handler_access.writes;
+                access.exclusive = access.exclusive || !handler_access.declared || handler_access.changes_structure;
+                access.handlers.emplace_back( handler );
+                events.insert( events.end(), handler_access.emits.begin(), handler_access.emits.end() );
+            }
+        }
+
+        std::sort( access.handlers.begin(), access.handlers.end() );
+        access.handlers.erase( std::unique( access.handlers.begin(), access.handlers.end() ), access.handlers.end() );
+    }
+
+    // a system is ticked after all the previously added systems it conflicts with
+    std::vector< size_t > groups( m_systems.size(), 0 );
+    m_schedule.clear();
+
+    for( size_t i{ 0 }; i < m_systems.size(); ++i )
+    {
+        for( size_t j{ 0 }; j < i; ++j )
+        {
+            if( groups[ j ] >= groups[ i ] &&
+                conflict( m_systems[ i ], accesses[ i ], m_systems[ j ], accesses[ j ] ) )
+            {
+                groups[ i ] = groups[ j ] + 1;
+            }
+        }
+
+        if( groups[ i ] >= m_schedule.size() )
+        {
+            m_schedule.resize( groups[ i ] + 1 );
+        }
+
+        m_schedule[ groups[ i ] ].emplace_back( m_systems[ i ] );
+    }
+
+    m_schedule_dirty = false;
+}
+
+uint64_t world::generate_serial() noexcept
+{
+    static std::atomic< uint64_t > serial{ 0 };
+    return ++serial;
+}
+
 system::system( world &world ) noexcept: m_world( world ){}
 
+void system::changes_structure() noexcept
+{
+    m_access.changes_structure = true;
+    m_access.declared = true;
+}
+
 }// ecs
@@ -2,11 +2,34 @@
 #define WORLD_H
 
 #include <list>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <thread>
 #include <algorithm>
+#include <functional>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "entity.h"
+#include "view.h"
+#include "prefab.h"
+#include "command_buffer.h"
+#include "details/mpsc_ring.h"
+#include "details/block_pool.h"
+#include "details/thread_pool.h"
+
+// Max number of entities processed by a single task of world::par_for_each_with()
+#ifndef ECS_PAR_CHUNK_SIZE
+#define ECS_PAR_CHUNK_SIZE 256
+#endif
+
+// Default capacity of the input event queues, see world::register_input()
+#ifndef ECS_INPUT_QUEUE_CAPACITY
+#define ECS_INPUT_QUEUE_CAPACITY 256
+#endif
 
 namespace ecs
 {
@@ -21,19 +44,254 @@ class event_callback_base{};
 }// _detail
 
 
+// Contiguous range of queued events, see world::set_event_queued()
+template< typename event_type >
+class event_span
+{
+public:
+    event_span( const event_type* begin, const event_type* end ) noexcept : m_begin( begin ), m_end( end ){}
+
+    const event_type* begin() const noexcept{ return m_begin; }
+    const event_type* end() const noexcept{ return m_end; }
+    size_t size() const noexcept{ return static_cast< size_t >( m_end - m_begin ); }
+    bool empty() const noexcept{ return m_begin == m_end; }
+    const event_type& operator[]( size_t i ) const noexcept{ return m_begin[ i ]; }
+
+private:
+    const event_type* m_begin{ nullptr };
+    const event_type* m_end{ nullptr };
+};
+
 // All classes subscribing to a certain event should inherit a specialization of this interface
 template< typename event_type >
 class event_callback : public _detail::event_callback_base
 {
 public:
     virtual void on_event( const event_type& event ) = 0;
+
+    // Receives the batches of queued events, override to handle them at once
+    virtual void on_events( const event_span< event_type >& events )
+    {
+        for( const event_type& event : events )
+        {
+            on_event( event );
+        }
+    }
+
     virtual ~event_callback() = default;
 };
 
+namespace _detail
+{
+
+using event_callbacks = std::unordered_set< event_callback_base* >;
+using entity_event_callbacks = std::unordered_map< entity_id, std::vector< event_callback_base* > >;
+
+// Events providing get_cause_entity() can be subscribed to for a single entity, see world::subscribe_for()
+template< typename event_type, typename = void >
+struct has_cause_entity : std::false_type{};
+
+template< typename event_type >
+struct has_cause_entity< event_type, typename std::enable_if< std::is_convertible<
+        decltype( std::declval< const event_type& >().get_cause_entity() ), const entity* >::value >::type > :
+    std::true_type{};
+
+// Callbacks subscribed for single entities, see world::subscribe_for(). Unlike the rest of the routing
+// they may be changed from any thread( e.g. by the GUI objects ) while the game thread delivers the events.
+// The callbacks are called under the lock, so once remove() returns the callback isn't called anymore.
+// The callbacks shouldn't subscribe or unsubscribe anything for the entities themselves
+class entity_callbacks_table final
+{
+public:
+    void add( type_id event, entity_id entity, event_callback_base* callback );
+    void remove( type_id event, entity_id entity, event_callback_base* callback );
+
+    // True if the event has ever had any callbacks, its emitters call handlers that aren't systems then
+    bool is_routed( type_id event ) const;
+
+    // True once after the first callback of an event has been added
+    bool take_new_events() noexcept;
+
+    template< typename event_type >
+    void notify( type_id event, const event_type& e ) const
+    {
+        notify( event, e, has_cause_entity< event_type >{} );
+    }
+
+private:
+    template< typename event_type >
+    void notify( type_id, const event_type&, std::false_type ) const{}
+
+    template< typename event_type >
+    void notify( type_id event, const event_type& e, std::true_type ) const
+    {
+        const entity* cause{ e.get_cause_entity() };
+        if( !cause || !m_count.load( std::memory_order_acquire ) )
+        {
+            return;
+        }
+
+        std::lock_guard< std::mutex > l{ m_mutex };
+        if( event < m_callbacks.size() )
+        {
+            auto it = m_callbacks[ event ].find( cause->get_id() );
+            if( it != m_callbacks[ event ].end() )
+            {
+                for( event_callback_base* subscriber : it->second )
+                {
+                    static_cast< event_callback< event_type >* >( subscriber )->on_event( e );
+                }
+            }
+        }
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector< entity_event_callbacks > m_callbacks; // indexed by event id
+    std::vector< bool > m_routed; // indexed by event id
+    std::atomic< size_t > m_count{ 0 };
+    std::atomic< bool > m_new_events{ false };
+};
+
+class event_queue_base
+{
+public:
+    virtual ~event_queue_base() = default;
+
+    // Delivers the queued events, returns false if there were none
+    virtual bool dispatch( type_id id, const event_callbacks& callbacks, const entity_callbacks_table& entity_callbacks ) = 0;
+    virtual void clear() = 0;
+};
+
+// Events of a single type waiting to be delivered, may be filled from several threads
+template< typename event_type >
+class event_queue final : public event_queue_base
+{
+public:
+    void push( const event_type& event )
+    {
+        std::lock_guard< std::mutex > l{ m_mutex };
+        m_events.emplace_back( event );
+    }
+
+    bool dispatch( type_id id, const event_callbacks& callbacks, const entity_callbacks_table& entity_callbacks ) override
+    {
+        {
+            // events emitted by the handlers go to the next batch
+            std::lock_guard< std::mutex > l{ m_mutex };
+            m_dispatched.swap( m_events );
+        }
+
+        if( m_dispatched.empty() )
+        {
+            return false;
+        }
+
+        event_span< event_type > events{ m_dispatched.data(), m_dispatched.data() + m_dispatched.size() };
+
+        try
+        {
+            for( event_callback_base* subscriber : callbacks )
+            {
+                static_cast< event_callback< event_type >* >( subscriber )->on_events( events );
+            }
+
+            for( const event_type& event : events )
+            {
+                entity_callbacks.notify( id, event );
+            }
+        }
+        catch( ... )
+        {
+            m_dispatched.clear();
+            throw;
+        }
+
+        m_dispatched.clear();
+        return true;
+    }
+
+    void clear() override
+    {
+        std::lock_guard< std::mutex > l{ m_mutex };
+        m_events.clear();
+    }
+
+private:
+    std::vector< event_type > m_events;
+    std::vector< event_type > m_dispatched; // the batch being delivered
+    std::mutex m_mutex;
+};
+
+class input_queue_base
+{
+public:
+    virtual ~input_queue_base() = default;
+
+    virtual void dispatch( type_id id, const event_callbacks& callbacks, const entity_callbacks_table& entity_callbacks ) = 0;
+    virtual void clear() noexcept = 0;
+};
+
+template< typename event_type >
+class input_queue final : public input_queue_base
+{
+public:
+    explicit input_queue( size_t capacity ) : m_ring( capacity ){}
+
+    bool push( const event_type& event ) noexcept
+    {
+        return m_ring.try_push( event );
+    }
+
+    void dispatch( type_id id, const event_callbacks& callbacks, const entity_callbacks_table& entity_callbacks ) override
+    {
+        auto deliver = [ & ]( const event_type& event )
+        {
+            for( event_callback_base* subscriber : callbacks )
+            {
+                static_cast< event_callback< event_type >* >( subscriber )->on_event( event );
+            }
+
+            entity_callbacks.notify( id, event );
+        };
+
+        // the events posted during the dispatch are left for the next one
+        for( size_t i{ 0 }; i < m_ring.capacity() && m_ring.try_pop( deliver ); ++i ){}
+    }
+
+    void clear() noexcept override
+    {
+        m_ring.clear();
+    }
+
+private:
+    mpsc_ring< event_type > m_ring;
+};
+
+class resource_base
+{
+public:
+    virtual ~resource_base() = default;
+};
+
+template< typename resource_type >
+class resource_holder final : public resource_base
+{
+public:
+    template< typename... args >
+    explicit resource_holder( args&&... a ) : value( std::forward< args >( a )... ){}
+
+    resource_type value;
+};
+
+}// _detail
+
 //
 
 class system
 {
+    friend class world;
+
 public:
     system( world& world ) noexcept;
     virtual ~system() = default;
@@ -42,8 +300,58 @@ public:
     virtual bool tick() = 0;
     virtual void clean(){}
 
+protected:
+    // Data access declarations, systems not conflicting with each other are ticked concurrently.
+    // They should cover the event handlers of the system as well and be made before add_system().
+    // A system without any declarations is always ticked alone
+    template< typename... components >
+    void reads()
+    {
+        m_access.reads |= make_component_mask< components... >();
+        m_access.declared = true;
+    }
+
+    template< typename... components >
+    void writes()
+    {
+        m_access.writes |= make_component_mask< components... >();
+        m_access.declared = true;
+    }
+
+    template< typename... events >
+    void emits()
+    {
+        using expander = int[];
+        (void)expander{ 0, ( m_access.emits.emplace_back( get_event_id< events >() ), 0 )... };
+        m_access.declared = true;
+    }
+
+    // The system creates or removes entities or components, so it's ticked alone
+    void changes_structure() noexcept;
+
 protected:
     world& m_world;
+
+private:
+    struct access
+    {
+        component_mask reads;
+        component_mask writes;
+        std::vector< type_id > emits;
+        bool changes_structure{ false };
+        bool declared{ false };
+    };
+
+    access m_access;
+};
+
+using observer_id = uint64_t;
+
+// Hit/miss counters of an entity pool, see world::recycle_or_create()
+struct pool_stats
+{
+    uint64_t hits{ 0 };
+    uint64_t misses{ 0 };
 };
 
 //
@@ -51,43 +359,115 @@ protected:
 class world final
 {
     using event_id = type_id;
-    using component_info = std::pair< entity::component_wrapper*, entity* >;
 
     friend class entity;
 
 public:
     world() = default;
 
-    // calls tick() of each system, clears objects schduled to be removed
+    // calls tick() of each system, plays back the recorded commands
+    // before the first system and after each group of concurrent systems
     bool tick();
 
-    void reset(); // remove all entities, clean() systems
-    void clean(); // remove all entities and systems
+    void reset(); // remove all entities and resources, clean() systems
+    void clean(); // remove all entities, resources and systems
 
     entity& create_entity();
+
+    // Creates an entity consisting of the prefab components or, if possible, reuses a removed entity
+    // of the same shape. Removed entities are pooled once recycle_or_create() has been called for their
+    // component set. args are the tuples of constructor arguments, one per component in the prefab order,
+    // e.g. recycle_or_create< prefab< a, b > >( std::forward_as_tuple( x, y ), std::make_tuple() ).
+    // Recycled entities get a new id, their components are reconstructed in place without any allocations
+    template< typename prefab_type, typename... arg_tuples >
+    entity& recycle_or_create( arg_tuples&&... args )
+    {
+        return recycle_or_create_impl( prefab_type{}, std::forward< arg_tuples >( args )... );
+    }
+
+    // Creates an entity consisting of the prefab components at once: the component storage is allocated
+    // a single time and the entity is put straight into its final archetype, which is cached per prefab.
+    // args are the same as the ones of recycle_or_create()
+    template< typename prefab_type, typename... arg_tuples >
+    entity& instantiate( arg_tuples&&... args )
+    {
+        return instantiate_impl( prefab_type{}, std::forward< arg_tuples >( args )... );
+    }
+
+    // Creates count entities of the prefab, all of them constructed from the same args. The storage
+    // of the world and of the archetype is reserved once for the whole batch
+    template< typename prefab_type, typename... arg_tuples >
+    std::vector< entity* > create_entities( size_t count, const arg_tuples&... args )
+    {
+        std::vector< entity* > entities;
+        entities.reserve( count );
+
+        reserve_entities( count );
+        archetype& a = get_prefab_archetype( get_type_id< prefab_type, prefab_family >(), prefab_type::get_mask() );
+        a.reserve( a.size() + count );
+
+        for( size_t i{ 0 }; i < count; ++i )
+        {
+            entities.emplace_back( &instantiate_impl( prefab_type{}, args... ) );
+        }
+
+        return entities;
+    }
+
+    // Makes room for count more entities, so that creating them doesn't reallocate the entity slots
+    void reserve_entities( size_t count );
+
+    template< typename prefab_type >
+    const pool_stats& get_pool_stats()
+    {
+        return m_entity_pools[ prefab_type::get_mask() ].stats;
+    }
+
+    // Throws std::out_of_range if the entity has been removed, even if its slot is reused
     entity& get_entity( entity_id id );
     bool entity_present( entity_id id ) const noexcept;
 
     void remove_entity( entity& e );
     void remove_entity( ecs::entity_id id );
+
+    // Removes the entities at once, the ids of the removed ones are skipped.
+    // The pool of the entity shape is looked up once per run of the entities of the same shape
+    void destroy_entities( const std::vector< entity_id >& ids );
+
+    // Removes all the entities having the component, archetype by archetype.
+    // The removal observers are called for the whole archetype first, so they must not remove its entities
+    template< typename component_type >
+    void destroy_all_with()
+    {
+        destroy_all_with( get_type_id< component_type >() );
+    }
+
+    void destroy_all_with( const type_id& component );
+    // The entity is marked as invalid and removed at the next sync point, may be called from any thread
     void schedule_remove_entity( entity& e );
     void schedule_remove_entity( ecs::entity_id id );
 
+    // Buffer of the calling thread for the structural changes which can't be made right away,
+    // e.g. from par_for_each_with() or from outside of the game thread
+    command_buffer& get_command_buffer();
+
+    // Plays back the commands recorded by all threads in the schedule order of the systems,
+    // should only be called from the game thread
+    void play_commands();
+
     template< typename component_1, typename... other_components >
     std::list< entity* > get_entities_with_components()
     {
         std::list< entity* > entities;
+        const component_mask& mask = get_component_mask< component_1, other_components... >();
 
-        auto it = m_components.find( get_type_id< component_1 >() );
-        if( it !=  m_components.end() )
+        for( size_t i{ 0 }; i < m_archetypes_list.size(); ++i )
         {
-            for( auto& value_pair : it->second )
+            archetype& a = *m_archetypes_list[ i ];
+            if( a.has_components( mask ) )
             {
-                entity* e{ value_pair.first };
-                if( has_components< other_components... >( *e ) )
-                {
-                    entities.emplace_back( value_pair.first );
-                }
+                entity* const* archetype_entities{ a.get_entities() };
+                entities.insert( entities.end(), archetype_entities, archetype_entities + a.size() );
             }
         }
 
@@ -99,80 +479,627 @@ public:
     template< typename component_type, typename... other_components, typename func_type >
     void for_each_with( func_type&& func )
     {
-        auto it = m_components.find( get_type_id< component_type >() );
-        if( it !=  m_components.end() )
+        for_each_chunk< component_type, other_components... >(
+        [ &func ]( const archetype_chunk< component_type, other_components... >& chunk )
+        {
+            for( size_t row{ 0 }; row < chunk.size(); ++row )
+            {
+                entity& e = chunk.get_entity( row );
+
+                if( e.get_state() == entity_state::ok &&
+                    !func( e,
+                           chunk.template get_component< component_type >( row ),
+                           chunk.template get_component< other_components >( row )... ) )
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        } );
+    }
+
+    // Same as for_each_with(), but only visits the entities whose component_type has been
+    // changed after the tick( see get_change_tick() ). Archetypes without such changes are skipped at once
+    template< typename component_type, typename... other_components, typename func_type >
+    void for_each_changed_since( uint64_t tick, func_type&& func )
+    {
+        entity::component_id changed_id{ get_type_id< component_type >() };
+
+        for_each_chunk< component_type, other_components... >(
+        [ &func, tick, changed_id ]( const archetype_chunk< component_type, other_components... >& chunk )
         {
-            for( auto value_pair : it->second )
+            if( chunk.template get_changed_tick< component_type >() <= tick )
             {
-                entity& e = *value_pair.first;
+                return true;
+            }
+
+            for( size_t row{ 0 }; row < chunk.size(); ++row )
+            {
+                entity& e = chunk.get_entity( row );
 
                 if( e.get_state() == entity_state::ok &&
-                    e.has_components< component_type, other_components... >() &&
-                    !e.apply_to< component_type, other_components... >( func ) )
+                    e.find_record( changed_id )->changed_tick > tick &&
+                    !func( e,
+                           chunk.template get_component< component_type >( row ),
+                           chunk.template get_component< other_components >( row )... ) )
                 {
-                    break;
+                    return false;
                 }
             }
+
+            return true;
+        } );
+    }
+
+    // Counter of the component changes, advanced before and after each group of systems in tick().
+    // A system storing it at the beginning of its tick() gets all the later changes made by the others
+    // from for_each_changed_since(), but not its own ones. Entities created or given a component count as changed
+    uint64_t get_change_tick() const noexcept;
+
+    // func should be of signature bool< const archetype_chunk< component_type, other_components... >& >
+    // and is called once per archetype containing all of the components.
+    // Entities and component pointers of a chunk are contiguous, see component_span
+    template< typename component_type, typename... other_components, typename func_type >
+    void for_each_chunk( func_type&& func )
+    {
+        using chunk_type = archetype_chunk< component_type, other_components... >;
+        const component_mask& mask = get_component_mask< component_type, other_components... >();
+
+        // archetypes may be created by func, so the list is accessed by index
+        for( size_t i{ 0 }; i < m_archetypes_list.size(); ++i )
+        {
+            archetype& a = *m_archetypes_list[ i ];
+            if( a.empty() || !a.has_components( mask ) )
+            {
+                continue;
+            }
+
+            std::array< size_t, 1 + sizeof...( other_components ) > columns{ {
+                    a.get_column_index( get_type_id< component_type >() ),
+                    a.get_column_index( get_type_id< other_components >() )... } };
+
+            if( !func( chunk_type{ a, columns.data() } ) )
+            {
+                break;
+            }
         }
     }
 
+    // Parallel version of for_each_with(): the matching entities are split into chunks
+    // processed on the world's worker pool, the call blocks until all of them are done.
+    // func should be of signature void< entity&, component_type_1&, ..., component_type_n&.... >,
+    // it must not create or remove entities or components and should synchronize access
+    // to anything besides the components of the entity it's been called for
+    template< typename component_type, typename... other_components, typename func_type >
+    void par_for_each_with( func_type&& func )
+    {
+        par_for_each_impl< component_type, other_components... >(
+        [ &func ]( size_t, entity& e, component_type& c, other_components&... other )
+        {
+            func( e, c, other... );
+        } );
+    }
+
+    // Same as above, but func also gets the state of the worker it's executed by:
+    // void< state_type&, entity&, component_type_1&, ..., component_type_n&.... >.
+    // worker_states is resized to the number of workers, so it can either be reduced
+    // once the call returns or kept between calls( e.g. to hold per worker random generators )
+    template< typename component_type, typename... other_components, typename state_type, typename func_type >
+    void par_for_each_with( std::vector< state_type >& worker_states, func_type&& func )
+    {
+        if( worker_states.size() < get_workers_num() )
+        {
+            worker_states.resize( get_workers_num() );
+        }
+
+        par_for_each_impl< component_type, other_components... >(
+        [ &func, &worker_states ]( size_t worker, entity& e, component_type& c, other_components&... other )
+        {
+            func( worker_states[ worker ], e, c, other... );
+        } );
+    }
+
+    // The pool is created on the first parallel call, 0 stands for the hardware concurrency
+    void set_workers_num( size_t workers_num );
+    size_t get_workers_num();
+
+    // Returns the view cached for the set of components, creating it on the first call.
+    // Views live as long as the world and stay up to date, so unlike
+    // get_entities_with_components() iterating one doesn't allocate
+    template< typename component_type, typename... other_components >
+    query_view< component_type, other_components... >& view()
+    {
+        using view_type = query_view< component_type, other_components... >;
+
+        type_id id{ get_type_id< view_type, view_family >() };
+        if( id >= m_views.size() )
+        {
+            m_views.resize( std::max< size_t >( id + 1, registered_types_num< view_family >() ) );
+        }
+
+        if( !m_views[ id ] )
+        {
+            std::unique_ptr< view_type > v{ new view_type{} };
+            for( archetype* a : m_archetypes_list )
+            {
+                v->try_add_archetype( *a );
+            }
+
+            m_views[ id ] = std::move( v );
+        }
+
+        return static_cast< view_type& >( *m_views[ id ] );
+    }
+
+    // Resources are the singletons owned by the world( e.g. the map size ), accessed by type without any entities.
+    // Replaces the current resource of the type, if any. Resources are removed along with the entities
+    // by reset() and clean(), so they may refer to the entities
+    template< typename resource_type, typename... args >
+    resource_type& set_resource( args&&... a )
+    {
+        type_id id{ get_type_id< resource_type, resource_family >() };
+        if( id >= m_resources.size() )
+        {
+            m_resources.resize( std::max< size_t >( id + 1, registered_types_num< resource_family >() ) );
+        }
+
+        std::unique_ptr< _detail::resource_holder< resource_type > > holder{
+            new _detail::resource_holder< resource_type >{ std::forward< args >( a )... } };
+
+        resource_type& r = holder->value;
+        m_resources[ id ] = std::move( holder );
+        return r;
+    }
+
+    // Throws std::out_of_range if the resource isn't set
+    template< typename resource_type >
+    resource_type& resource()
+    {
+        return static_cast< _detail::resource_holder< resource_type >& >(
+                    get_resource( get_type_id< resource_type, resource_family >() ) ).value;
+    }
+
+    template< typename resource_type >
+    const resource_type& resource() const
+    {
+        return static_cast< const _detail::resource_holder< resource_type >& >(
+                    get_resource( get_type_id< resource_type, resource_family >() ) ).value;
+    }
+
+    template< typename resource_type >
+    bool has_resource() const noexcept
+    {
+        type_id id{ get_type_id< resource_type, resource_family >() };
+        return id < m_resources.size() && m_resources[ id ];
+    }
+
+    template< typename resource_type >
+    void remove_resource()
+    {
+        type_id id{ get_type_id< resource_type, resource_family >() };
+        if( id < m_resources.size() )
+        {
+            m_resources[ id ].reset();
+        }
+    }
+
+    // Systems are ticked in the order they've been added, except for the ones
+    // not conflicting with each other, which are ticked concurrently( see system::reads() )
     void add_system( system& system );
     void remove_system( system& s );
     void schedule_remove_system( system& system );
 
+    // func should be of signature void< entity&, component_type& > and is called right after the component
+    // is added to an entity, including the entities created by recycle_or_create(). Observers are called
+    // by the thread making the change, so the deferred changes are observed when the commands are played back
+    template< typename component_type, typename func_type >
+    observer_id on_added( func_type&& func )
+    {
+        return add_observer( get_type_id< component_type >(),
+                             observer_kind::added,
+                             make_observer< component_type >( std::forward< func_type >( func ) ) );
+    }
+
+    // Same as on_added(), but func is called right before the component is removed,
+    // either alone or along with the entity. Neither is called by reset() and clean()
+    template< typename component_type, typename func_type >
+    observer_id on_removed( func_type&& func )
+    {
+        return add_observer( get_type_id< component_type >(),
+                             observer_kind::removed,
+                             make_observer< component_type >( std::forward< func_type >( func ) ) );
+    }
+
+    void remove_observer( observer_id id );
+
     template< typename event_type >
     void subscribe( event_callback< event_type >& callback )
     {
-        m_subscribers[ get_type_id< event_type >() ].emplace( &callback );
+        event_id id{ get_event_id< event_type >() };
+        if( id >= m_subscribers.size() )
+        {
+            m_subscribers.resize( std::max< size_t >( id + 1, registered_types_num< event_family >() ) );
+        }
+
+        event_subscribers& subscribers = m_subscribers[ id ];
+        subscribers.callbacks.emplace( &callback );
+
+        // handlers of systems are taken into account when scheduling the emitters
+        system* s{ dynamic_cast< system* >( &callback ) };
+        if( s )
+        {
+            subscribers.systems.emplace( s );
+        }
+
+        m_schedule_dirty = true;
     }
 
     template< typename event_type >
     void unsubscribe( event_callback< event_type >& callback )
     {
-        auto it = m_subscribers.find( get_type_id< event_type >() );
-        if( it != m_subscribers.end() )
+        event_id id{ get_event_id< event_type >() };
+        if( id < m_subscribers.size() )
+        {
+            m_subscribers[ id ].callbacks.erase( &callback );
+            m_subscribers[ id ].systems.erase( dynamic_cast< system* >( &callback ) );
+            m_schedule_dirty = true;
+        }
+    }
+
+    // The callback only receives the events caused by the entity. Unlike subscribe(), the cost of
+    // emitting doesn't grow with the number of such callbacks, and both functions may be called from
+    // any thread. Callbacks aren't unsubscribed on entity removal, and the id of a removed entity comes
+    // back once the version of its slot wraps, so the callback should be unsubscribed along with the entity
+    template< typename event_type >
+    void subscribe_for( entity_id entity, event_callback< event_type >& callback )
+    {
+        static_assert( _detail::has_cause_entity< event_type >::value,
+                       "Only the events providing get_cause_entity() can be subscribed to for an entity" );
+
+        m_entity_callbacks.add( get_event_id< event_type >(), entity, &callback );
+    }
+
+    template< typename event_type >
+    void unsubscribe_for( entity_id entity, event_callback< event_type >& callback )
+    {
+        m_entity_callbacks.remove( get_event_id< event_type >(), entity, &callback );
+    }
+
+    // Events of queued types are stored by emit_event() and delivered in batches by dispatch_events(),
+    // which tick() calls at its sync points. Emitting queued events is thread safe, their handlers are
+    // called from the game thread and don't take part in the scheduling of the emitters.
+    // The pending events are delivered when the queue is disabled
+    template< typename event_type >
+    void set_event_queued( bool queued = true )
+    {
+        event_id id{ get_event_id< event_type >() };
+        if( id >= m_event_queues.size() )
+        {
+            m_event_queues.resize( std::max< size_t >( id + 1, registered_types_num< event_family >() ) );
+            m_subscribers.resize( std::max< size_t >( m_subscribers.size(), m_event_queues.size() ) );
+        }
+
+        std::unique_ptr< _detail::event_queue_base >& queue = m_event_queues[ id ];
+        if( queued && !queue )
+        {
+            queue.reset( new _detail::event_queue< event_type >{} );
+        }
+        else if( !queued && queue )
+        {
+            queue->dispatch( id, m_subscribers[ id ].callbacks, m_entity_callbacks );
+            queue.reset();
+        }
+
+        m_schedule_dirty = true;
+    }
+
+    template< typename event_type >
+    bool is_event_queued() const noexcept
+    {
+        event_id id{ get_event_id< event_type >() };
+        return id < m_event_queues.size() && m_event_queues[ id ];
+    }
+
+    // Delivers the events of the queued types, should only be called from the game thread
+    void dispatch_events();
+
+    // Input events are posted from other threads( e.g. the GUI ) without any locking and delivered
+    // at the beginning of the next tick. The type should be registered from the game thread before
+    // anything is posted, the capacity limits the number of events waiting for the delivery
+    template< typename event_type >
+    void register_input( size_t capacity = ECS_INPUT_QUEUE_CAPACITY )
+    {
+        event_id id{ get_event_id< event_type >() };
+        if( id >= m_input_queues.size() )
         {
-            it->second.erase( &callback );
+            m_input_queues.resize( std::max< size_t >( id + 1, registered_types_num< event_family >() ) );
+            m_subscribers.resize( std::max< size_t >( m_subscribers.size(), m_input_queues.size() ) );
+        }
+
+        if( !m_input_queues[ id ] )
+        {
+            m_input_queues[ id ].reset( new _detail::input_queue< event_type >{ capacity } );
         }
     }
 
+    // Returns false if the queue is full
+    template< typename event_type >
+    bool post_input( const event_type& event ) noexcept
+    {
+        event_id id{ get_event_id< event_type >() };
+        assert( id < m_input_queues.size() && m_input_queues[ id ] && "Input event type isn't registered" );
+        return static_cast< _detail::input_queue< event_type >& >( *m_input_queues[ id ] ).push( event );
+    }
+
+    // Delivers the posted input events, should only be called from the game thread
+    void dispatch_input();
+
     template< typename event_type >
     void emit_event( const event_type& event )
     {
-        auto it = m_subscribers.find( get_type_id< event_type >() );
-        if( it != m_subscribers.end() )
+        event_id id{ get_event_id< event_type >() };
+        if( id < m_event_queues.size() && m_event_queues[ id ] )
+        {
+            static_cast< _detail::event_queue< event_type >& >( *m_event_queues[ id ] ).push( event );
+        }
+        else
         {
-            for( auto& subscriber : it->second )
+            if( id < m_subscribers.size() )
             {
-                event_callback< event_type >* callback{ static_cast< event_callback< event_type >* >( subscriber ) };
-                callback->on_event( event );
+                for( auto& subscriber : m_subscribers[ id ].callbacks )
+                {
+                    event_callback< event_type >* callback{ static_cast< event_callback< event_type >* >( subscriber ) };
+                    callback->on_event( event );
+                }
             }
+
+            m_entity_callbacks.notify( id, event );
         }
     }
 
 private:
-    void add_component( entity& e, const entity::component_id& id, entity::component_wrapper& w );
+    template< typename... components, typename... arg_tuples >
+    entity& recycle_or_create_impl( const prefab< components... >&, arg_tuples&&... args )
+    {
+        static_assert( sizeof...( components ) == sizeof...( arg_tuples ),
+                       "Constructor arguments should be supplied for each component" );
+
+        using expander = int[];
+        entity_pool& pool = m_entity_pools[ get_component_mask< components... >() ];
+
+        if( !pool.entities.empty() )
+        {
+            ++pool.stats.hits;
+
+            std::unique_ptr< entity > pooled{ std::move( pool.entities.back() ) };
+            pool.entities.pop_back();
+
+            (void)expander{ 0, ( pooled->reconstruct_component_from_tuple< components >(
+                                     std::forward< arg_tuples >( args ),
+                                     make_sequence_for< arg_tuples >() ), 0 )... };
+
+            entity& e = insert_entity( std::move( pooled ) );
+            move_entity( e, &get_archetype( e.m_mask ) );
+            notify_observers( e, observer_kind::added );
+            return e;
+        }
+
+        ++pool.stats.misses;
+        return instantiate_impl( prefab< components... >{}, std::forward< arg_tuples >( args )... );
+    }
+
+    template< typename... components, typename... arg_tuples >
+    entity& instantiate_impl( const prefab< components... >&, arg_tuples&&... args )
+    {
+        static_assert( sizeof...( components ) == sizeof...( arg_tuples ),
+                       "Constructor arguments should be supplied for each component" );
+
+        using expander = int[];
+        using prefab_type = prefab< components... >;
+
+        archetype& a = get_prefab_archetype( get_type_id< prefab_type, prefab_family >(), prefab_type::get_mask() );
+        entity& e = create_entity();
+
+        try
+        {
+            e.reserve_components( sizeof...( components ) );
+            (void)expander{ 0, ( e.emplace_component_from_tuple< components >(
+                                     std::forward< arg_tuples >( args ),
+                                     make_sequence_for< arg_tuples >() ), 0 )... };
+        }
+        catch( ... )
+        {
+            // the entity isn't in any archetype yet, so nobody has seen its components
+            e.clear_components();
+            e.m_mask.reset();
+            remove_entity( e );
+            throw;
+        }
+
+        move_entity( e, &a );
+        notify_observers( e, observer_kind::added );
+        return e;
+    }
+
+    // func is of signature void< size_t worker, entity&, component_type_1&, ..., component_type_n&.... >
+    template< typename component_type, typename... other_components, typename func_type >
+    void par_for_each_impl( const func_type& func )
+    {
+        using columns_type = std::array< size_t, 1 + sizeof...( other_components ) >;
+
+        struct chunk
+        {
+            archetype* a;
+            size_t begin;
+            size_t end;
+            columns_type columns;
+        };
+
+        const component_mask& mask = get_component_mask< component_type, other_components... >();
+        std::vector< chunk > chunks;
+
+        for( archetype* a : m_archetypes_list )
+        {
+            if( a->empty() || !a->has_components( mask ) )
+            {
+                continue;
+            }
+
+            columns_type columns{ {
+                    a->get_column_index( get_type_id< component_type >() ),
+                    a->get_column_index( get_type_id< other_components >() )... } };
+
+            for( size_t begin{ 0 }; begin < a->size(); begin += ECS_PAR_CHUNK_SIZE )
+            {
+                chunks.push_back( chunk{ a, begin, std::min< size_t >( begin + ECS_PAR_CHUNK_SIZE, a->size() ), columns } );
+            }
+        }
+
+        // each task records its commands in a step of its own, so the playback doesn't depend on the workers
+        _detail::command_order order{ _detail::current_command_order() };
+
+        get_thread_pool().parallel_for( chunks.size(), [ & ]( size_t worker, size_t task )
+        {
+            _detail::command_order_scope task_order{ _detail::command_order{ order.system, order.step + 1 + task } };
+            const chunk& c = chunks[ task ];
+            for( size_t row{ c.begin }; row < c.end; ++row )
+            {
+                entity& e = c.a->get_entity( row );
+                if( e.get_state() == entity_state::ok )
+                {
+                    func( worker,
+                          e,
+                          *static_cast< component_type* >( c.a->get_component( row, c.columns[ 0 ] ) ),
+                          *static_cast< other_components* >( c.a->get_component(
+                              row,
+                              c.columns[ _detail::type_position< other_components,
+                                                                 component_type,
+                                                                 other_components... >::value ] ) )... );
+                }
+            }
+        } );
+
+        // the commands recorded after the loop follow the ones of its tasks
+        _detail::current_command_order().step += chunks.size() + 1;
+    }
+
+    using component_observer = std::function< void( entity& ) >;
+    enum class observer_kind{ added, removed };
+
+    template< typename component_type, typename func_type >
+    static component_observer make_observer( func_type&& func )
+    {
+        typename std::decay< func_type >::type f( std::forward< func_type >( func ) );
+        return [ f ]( entity& e ) mutable
+        {
+            f( e, e.get_component_unsafe< component_type >() );
+        };
+    }
+
+    observer_id add_observer( const type_id& component, observer_kind kind, component_observer observer );
+    void notify_observers( entity& e, const type_id& component, observer_kind kind );
+    void notify_observers( entity& e, observer_kind kind ); // for all the components of the entity
+
+    _detail::resource_base& get_resource( const type_id& id );
+    const _detail::resource_base& get_resource( const type_id& id ) const;
+
+    _detail::thread_pool& get_thread_pool();
+
+    void build_schedule();
+
+    static uint64_t generate_serial() noexcept;
+
+    template< typename args_tuple >
+    static std::make_index_sequence< std::tuple_size< typename std::decay< args_tuple >::type >::value >
+    make_sequence_for() noexcept
+    {
+        return {};
+    }
+
+    struct entity_pool;
+
+    entity& insert_entity( std::unique_ptr< entity > e );
+    void release_entity( entity& e, entity_pool* pool );
+    entity_pool* find_pool( const component_mask& mask );
+
+    void add_component( entity& e, const entity::component_id& id );
     void remove_component( entity& e, const entity::component_id& id );
     void cleanup();
+    void play_command( const command_buffer::command& c );
+    void discard_commands();
+    void discard_events();
 
-    template< typename... components,
-              typename std::enable_if< sizeof...( components ) != 0 >::type* = nullptr >
-    bool has_components( const entity& e ){ return e.has_components< components... >(); }
-
-    template< typename... components,
-              typename std::enable_if< sizeof...( components ) == 0 >::type* = nullptr >
-    bool has_components( const entity& ){ return true; }
+    archetype& get_archetype( const component_mask& mask );
+    archetype& get_prefab_archetype( const type_id& prefab, const component_mask& mask );
+    void move_entity( entity& e, archetype* to );
+    void detach_entity( entity& e ) noexcept;
+    void clear_archetypes() noexcept;
+    void clear_entities();
 
 private:
-    std::unordered_set< system* > m_systems;
-    std::unordered_map< entity_id, std::unique_ptr< entity > > m_entities;
-    std::unordered_map< entity::component_id,
-                        std::unordered_map< entity*, entity::component_wrapper* > > m_components;
+    struct entity_slot
+    {
+        std::unique_ptr< entity > e;
+        numeric_id version{ 0 };
+    };
+
+    // declared first and destroyed last, the entities give their records back on destruction
+    _detail::block_pool< entity::component_record > m_component_records;
+
+    std::vector< system* > m_systems; // in the order of addition
+    std::vector< std::vector< system* > > m_schedule; // groups of systems ticked concurrently
+    bool m_schedule_dirty{ true };
+    std::vector< entity_slot > m_entity_slots; // indexed by the entity index part of the id
+    std::vector< numeric_id > m_free_entity_slots;
+
+    struct entity_pool
+    {
+        std::vector< std::unique_ptr< entity > > entities;
+        pool_stats stats;
+    };
+
+    std::unordered_map< component_mask, entity_pool > m_entity_pools;
+    std::unordered_map< component_mask, std::unique_ptr< archetype > > m_archetypes;
+    std::vector< archetype* > m_archetypes_list;
+    std::vector< archetype* > m_prefab_archetypes; // indexed by prefab id, archetypes live as long as the world
+    std::vector< std::unique_ptr< _detail::view_base > > m_views; // indexed by view id
 
     std::unordered_set< system* > m_systems_to_remove;
-    std::unordered_set< entity* > m_entities_to_remove;
 
-    std::unordered_map< event_id, std::unordered_set< _detail::event_callback_base* > > m_subscribers;
+    struct component_observers
+    {
+        std::vector< std::pair< observer_id, component_observer > > added;
+        std::vector< std::pair< observer_id, component_observer > > removed;
+    };
+
+    std::vector< component_observers > m_observers; // indexed by component id
+    observer_id m_last_observer_id{ 0 };
+
+    // declared after the observers and destroyed before them, so that a resource may remove its own
+    std::vector< std::unique_ptr< _detail::resource_base > > m_resources; // indexed by resource id
+
+    std::atomic< uint64_t > m_change_tick{ 1 };
+
+    const uint64_t m_serial{ generate_serial() }; // identifies the world in the thread local buffer cache
+    std::mutex m_command_buffers_mutex;
+    std::unordered_map< std::thread::id, std::unique_ptr< command_buffer > > m_command_buffers;
+    std::vector< command_buffer* > m_command_buffers_list; // in the order of creation
+    std::vector< command_buffer::command > m_commands_to_play;
+
+    struct event_subscribers
+    {
+        _detail::event_callbacks callbacks;
+        std::unordered_set< system* > systems; // callbacks that are systems
+    };
+
+    std::vector< event_subscribers > m_subscribers; // indexed by event id
+    std::vector< std::unique_ptr< _detail::event_queue_base > > m_event_queues; // indexed by event id, null if not queued
+    std::vector< std::unique_ptr< _detail::input_queue_base > > m_input_queues; // indexed by event id, null if not input
+    _detail::entity_callbacks_table m_entity_callbacks;
+
+    std::unique_ptr< _detail::thread_pool > m_thread_pool;
+    size_t m_workers_num{ 0 };
 };
 
 }// ecs
@@ -10,108 +10,228 @@ inline uint qHash( const QRect& r)
     return qHash( r.left() ) + qHash( r.top() ) + qHash( r.width() ) + qHash( r.bottom() );
 }
 
-template< typename T >
-T abs_diff( T l, T r ) noexcept
+namespace game
+{
+
+map_tile_node::map_tile_node( ecs::entity& e, const QRect& rect, int row, int col, map_graph& graph ) :
+    m_graph( &graph ),
+    m_tile_entity( &e ),
+    m_origin( rect.topLeft() ),
+    m_row( row ),
+    m_col( col ),
+    m_tile_type( e.get_component< component::tile_object >().get_tile_type() ){}
+
+map_tile_node* map_tile_node::get_left() const noexcept
 {
-    return  l >= r? l - r : r - l;
+    return m_graph->get_node( m_row, m_col - 1 );
 }
 
-namespace game
+map_tile_node* map_tile_node::get_right() const noexcept
 {
+    return m_graph->get_node( m_row, m_col + 1 );
+}
 
-map_tile_node::map_tile_node( ecs::entity& e ) noexcept : m_tile_entity( &e ){}
+map_tile_node* map_tile_node::get_top() const noexcept
+{
+    return m_graph->get_node( m_row - 1, m_col );
+}
 
-void map_tile_node::set_left( map_tile_node& node ) noexcept
+map_tile_node* map_tile_node::get_bottom() const noexcept
 {
-    m_left = &node;
+    return m_graph->get_node( m_row + 1, m_col );
 }
 
-void map_tile_node::set_right( map_tile_node& node ) noexcept
+ecs::entity& map_tile_node::get_entity() noexcept
 {
-    m_right = &node;
+    return *m_tile_entity;
 }
 
-void map_tile_node::set_top( map_tile_node& node ) noexcept
+const ecs::entity& map_tile_node::get_entity() const noexcept
 {
-    m_top = &node;
+    return *m_tile_entity;
 }
 
-void map_tile_node::set_bottom( map_tile_node& node ) noexcept
+void map_tile_node::set_tile_type( const tile_type& type ) noexcept
 {
-    m_bottom = &node;
+    m_tile_type = type;
 }
 
-map_tile_node* map_tile_node::get_left() const noexcept
+const tile_type& map_tile_node::get_tile_type() const noexcept
 {
-    return m_left;
+    return m_tile_type;
 }
 
-map_tile_node* map_tile_node::get_right() const noexcept
+void map_tile_node::set_traversible( bool traversible ) noexcept
 {
-    return m_right;
+    m_graph->get_traversability().set_blocked( cell_layer::tiles, m_row, m_col, !traversible );
 }
 
-map_tile_node* map_tile_node::get_top() const noexcept
+bool map_tile_node::is_traversible() const noexcept
 {
-    return m_top;
+    return !m_graph->get_traversability().is_blocked( cell_layer::tiles, m_row, m_col );
 }
 
-map_tile_node* map_tile_node::get_bottom() const noexcept
+QRect map_tile_node::get_rect() const noexcept
 {
-    return m_bottom;
+    return QRect{ m_origin, m_graph->get_tile_size() };
 }
 
-ecs::entity& map_tile_node::get_entity() noexcept
+int map_tile_node::get_row() const noexcept
 {
-    return *m_tile_entity;
+    return m_row;
 }
 
-const ecs::entity& map_tile_node::get_entity() const noexcept
+int map_tile_node::get_col() const noexcept
 {
-    return *m_tile_entity;
+    return m_col;
 }
 
-bool map_tile_node::is_traversible() const noexcept
+map_graph& map_tile_node::get_graph() const noexcept
+{
+    return *m_graph;
+}
+
+//
+
+void map_graph::assign( int rows, int columns, const QSize& tile_size, const std::vector< ecs::entity* >& tiles )
+{
+    if( rows < 0 || columns < 0 || tiles.size() != static_cast< size_t >( rows * columns ) )
+    {
+        throw std::invalid_argument{ "Number of tiles doesn't match the graph size" };
+    }
+
+    clear();
+
+    m_rows = rows;
+    m_columns = columns;
+    m_tile_size = tile_size;
+    m_origin = tiles.empty()? QPoint{} : tiles.front()->get_component< component::geometry >().get_rect().topLeft();
+    m_nodes.reserve( tiles.size() );
+    m_traversability.resize( rows, columns );
+
+    for( size_t i{ 0 }; i < tiles.size(); ++i )
+    {
+        ecs::entity& tile = *tiles[ i ];
+        m_nodes.emplace_back( tile,
+                              tile.get_component< component::geometry >().get_rect(),
+                              static_cast< int >( i ) / columns,
+                              static_cast< int >( i ) % columns,
+                              *this );
+
+        m_nodes.back().set_traversible( !tile.has_component< component::non_traversible_tile >() );
+    }
+}
+
+void map_graph::clear() noexcept
 {
-    return m_tile_entity->has_component< component::non_traversible_tile >() ||
-           m_tile_entity->has_component< component::non_traversible_object >();
+    m_nodes.clear();
+    m_traversability.resize( 0, 0 );
+    m_rows = 0;
+    m_columns = 0;
 }
 
-const QRect& map_tile_node::get_rect() const noexcept
+size_t map_graph::size() const noexcept
 {
-    return m_tile_entity->get_component< component::geometry >().get_rect();
+    return m_nodes.size();
 }
 
-size_t get_row( size_t node, size_t col_count ) noexcept
+bool map_graph::empty() const noexcept
 {
-    return node / col_count;
+    return m_nodes.empty();
 }
 
-size_t get_col( size_t node, size_t col_count ) noexcept
+int map_graph::get_rows_count() const noexcept
 {
-    return node % col_count;
+    return m_rows;
 }
 
-map_tile_node& get_node( int row, int col, size_t col_count, map_graph& graph ) noexcept
+int map_graph::get_columns_count() const noexcept
 {
-    return *graph[ row * col_count +col ];
+    return m_columns;
 }
 
-bool is_adjacent( size_t node1, size_t node2, size_t col_count ) noexcept
+const QSize& map_graph::get_tile_size() const noexcept
 {
-    size_t node1_row{ get_row( node1, col_count ) };
-    size_t node2_row{ get_row( node2, col_count ) };
-    size_t node1_col{ get_col( node1, col_count ) };
-    size_t node2_col{ get_col( node2, col_count ) };
+    return m_tile_size;
+}
 
-    return ( node1_row == node2_row && abs_diff( node1_col, node2_col ) == 1 ) ||
-           ( node1_col == node2_col && abs_diff( node1_row, node2_row ) == 1 );
+map_tile_node& map_graph::operator[]( size_t index ) noexcept
+{
+    return m_nodes[ index ];
 }
 
-int get_dist_adjacent( size_t to, const map_graph& graph ) noexcept
+const map_tile_node& map_graph::operator[]( size_t index ) const noexcept
 {
-    return graph[ to ]->get_entity().has_component< component::non_traversible_tile >()?
-                value_non_traversible : value_traversible;
+    return m_nodes[ index ];
+}
+
+map_tile_node* map_graph::get_node( int row, int col ) noexcept
+{
+    return row >= 0 && row < m_rows && col >= 0 && col < m_columns?
+                &m_nodes[ static_cast< size_t >( row * m_columns + col ) ] : nullptr;
+}
+
+const map_tile_node* map_graph::get_node( int row, int col ) const noexcept
+{
+    return row >= 0 && row < m_rows && col >= 0 && col < m_columns?
+                &m_nodes[ static_cast< size_t >( row * m_columns + col ) ] : nullptr;
+}
+
+size_t map_graph::get_index( const map_tile_node& node ) const noexcept
+{
+    return static_cast< size_t >( node.get_row() * m_columns + node.get_col() );
+}
+
+traversability_map& map_graph::get_traversability() noexcept
+{
+    return m_traversability;
+}
+
+const traversability_map& map_graph::get_traversability() const noexcept
+{
+    return m_traversability;
+}
+
+bool map_graph::is_free( const QRect& rect, const cell_layer& layer ) const noexcept
+{
+    int first_row{ 0 };
+    int first_col{ 0 };
+    int last_row{ -1 };
+    int last_col{ -1 };
+    get_cell_range( rect, first_row, first_col, last_row, last_col );
+
+    return m_traversability.is_free( layer, first_row, first_col, last_row, last_col );
+}
+
+void map_graph::get_cell_range( const QRect& rect,
+                                int& first_row,
+                                int& first_col,
+                                int& last_row,
+                                int& last_col ) const noexcept
+{
+    if( m_nodes.empty() || rect.isEmpty() )
+    {
+        return;
+    }
+
+    QRect map_rect{ m_origin, QSize{ m_columns * m_tile_size.width(), m_rows * m_tile_size.height() } };
+    QRect area{ rect.intersected( map_rect ) };
+    if( area.isEmpty() )
+    {
+        return;
+    }
+
+    first_col = ( area.left() - m_origin.x() ) / m_tile_size.width();
+    last_col = ( area.right() - m_origin.x() ) / m_tile_size.width();
+    first_row = ( area.top() - m_origin.y() ) / m_tile_size.height();
+    last_row = ( area.bottom() - m_origin.y() ) / m_tile_size.height();
+}
+
+//
+
+int get_dist_adjacent( const map_tile_node& to ) noexcept
+{
+    return to.is_traversible()? value_traversible : value_non_traversible;
 }
 
 int min_distance( const std::vector< int >& dist, const std::vector< bool >& spt_set, int max ) noexcept
@@ -137,8 +257,8 @@ void construct_path( size_t from,
                      map_graph& graph,
                      map_paths& paths )
 {
-    const map_tile_node& from_node = *graph[ from ];
-    const map_tile_node& to_node = *graph[ to ];
+    const map_tile_node& from_node = graph[ from ];
+    const map_tile_node& to_node = graph[ to ];
 
     if( paths.count( map_path_key{ to_node.get_rect(), from_node.get_rect() } ) )
     {
@@ -152,12 +272,12 @@ void construct_path( size_t from,
     int parent{ parents[ to ] };
     while( parent != -1 )
     {
-        path.push_front( graph[ parent ].get() );
+        path.push_front( &graph[ parent ] );
         parent = parents[ parent ];
     }
 }
 
-void dijkstra( size_t from, map_graph& graph, size_t col_count, map_paths& paths )
+void dijkstra( size_t from, map_graph& graph, map_paths& paths )
 {
     static std::vector< bool > spt_set;
     static std::vector< int > distances;
@@ -184,11 +304,18 @@ void dijkstra( size_t from, map_graph& graph, size_t col_count, map_paths& paths
         int min_index{ min_distance( distances, spt_set, (int)graph.size() ) };
         spt_set[ min_index ] = true;
 
-         for( size_t node{ 0 }; node < graph.size(); ++node )
+         const map_tile_node& min_node = graph[ min_index ];
+         const map_tile_node* neighbours[]{ min_node.get_left(),
+                                            min_node.get_right(),
+                                            min_node.get_top(),
+                                            min_node.get_bottom() };
+
+         for( const map_tile_node* neighbour : neighbours )
          {
-             if( !spt_set[ node ] && is_adjacent( min_index, node, col_count ) )
+             if( neighbour && !spt_set[ graph.get_index( *neighbour ) ] )
              {
-                 int dist{ distances[ min_index ] + get_dist_adjacent( node, graph ) };
+                 size_t node{ graph.get_index( *neighbour ) };
+                 int dist{ distances[ min_index ] + get_dist_adjacent( *neighbour ) };
                  if( dist < distances[ node ] )
                  {
                      parents[ node ] = min_index;
@@ -204,26 +331,4 @@ void dijkstra( size_t from, map_graph& graph, size_t col_count, map_paths& paths
     }
 }
 
-map_tile_node& create_map_node( ecs::entity& e, int row, int col, int col_count, map_graph& graph )
-{
-    graph.emplace_back( std::make_unique< map_tile_node >( e ) );
-    auto& node = graph.back();
-
-    if( row > 0 )
-    {
-        map_tile_node& top_node = get_node( row - 1, col, col_count, graph );
-        node->set_top( top_node );
-        top_node.set_bottom( *node );
-    }
-
-    if( col > 0 )
-    {
-        map_tile_node& left_node = get_node( row, col - 1, col_count, graph );
-        node->set_left( left_node );
-        left_node.set_right( *node );
-    }
-
-    return *node;
-}
-
 }// game
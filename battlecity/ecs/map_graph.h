@@ -5,22 +5,23 @@
 #include <deque>
 
 #include <QRect>
+#include <QSize>
 #include <QHash>
 
+#include "general_enums.h"
+#include "traversability_map.h"
 #include "framework/entity.h"
 
 namespace game
 {
 
-class map_tile_node
+class map_graph;
+
+// Cell of map_graph. Keeps the tile's data inline, the neighbours are found by the position in the graph
+class map_tile_node final
 {
 public:
-    explicit map_tile_node( ecs::entity& e ) noexcept;
-
-    void set_left( map_tile_node& node ) noexcept;
-    void set_right( map_tile_node& node ) noexcept;
-    void set_top( map_tile_node& node ) noexcept;
-    void set_bottom( map_tile_node& node ) noexcept;
+    map_tile_node( ecs::entity& e, const QRect& rect, int row, int col, map_graph& graph );
 
     map_tile_node* get_left() const noexcept;
     map_tile_node* get_right() const noexcept;
@@ -30,24 +31,97 @@ public:
     ecs::entity& get_entity() noexcept;
     const ecs::entity& get_entity() const noexcept;
 
+    // Mirror the tile's tile_object and non_traversible_tile, should be updated along with them.
+    // Traversability is kept in the tiles layer of the graph's traversability_map
+    void set_tile_type( const tile_type& type ) noexcept;
+    const tile_type& get_tile_type() const noexcept;
+    void set_traversible( bool traversible ) noexcept;
     bool is_traversible() const noexcept;
-    const QRect& get_rect() const noexcept;
+
+    QRect get_rect() const noexcept;
+    int get_row() const noexcept;
+    int get_col() const noexcept;
+    map_graph& get_graph() const noexcept;
 
 private:
-    map_tile_node* m_left{ nullptr };
-    map_tile_node* m_right{ nullptr };
-    map_tile_node* m_top{ nullptr };
-    map_tile_node* m_bottom{ nullptr };
+    map_graph* m_graph{ nullptr };
     ecs::entity* m_tile_entity{ nullptr };
+    QPoint m_origin;
+    int m_row{ 0 };
+    int m_col{ 0 };
+    tile_type m_tile_type{ tile_type::empty };
+};
+
+// Tile nodes of the map stored row by row in a single array
+class map_graph final
+{
+public:
+    // Takes the tiles row by row. The nodes stay at the same addresses until the next assign() or clear()
+    void assign( int rows, int columns, const QSize& tile_size, const std::vector< ecs::entity* >& tiles );
+    void clear() noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    int get_rows_count() const noexcept;
+    int get_columns_count() const noexcept;
+    const QSize& get_tile_size() const noexcept;
+
+    map_tile_node& operator[]( size_t index ) noexcept;
+    const map_tile_node& operator[]( size_t index ) const noexcept;
+
+    // nullptr if outside the map
+    map_tile_node* get_node( int row, int col ) noexcept;
+    const map_tile_node* get_node( int row, int col ) const noexcept;
+
+    size_t get_index( const map_tile_node& node ) const noexcept;
+
+    traversability_map& get_traversability() noexcept;
+    const traversability_map& get_traversability() const noexcept;
+
+    // True if none of the cells the rect overlaps is blocked in the layer
+    bool is_free( const QRect& rect, const cell_layer& layer ) const noexcept;
+
+    // func should be of signature bool( map_tile_node& ) and is called row by row
+    // for every node the rect overlaps. Returning false stops the iteration
+    template< typename func_type >
+    void for_each_node_in( const QRect& rect, func_type&& func )
+    {
+        int first_row{ 0 };
+        int first_col{ 0 };
+        int last_row{ -1 };
+        int last_col{ -1 };
+        get_cell_range( rect, first_row, first_col, last_row, last_col );
+
+        for( int row{ first_row }; row <= last_row; ++row )
+        {
+            for( int col{ first_col }; col <= last_col; ++col )
+            {
+                if( !func( m_nodes[ static_cast< size_t >( row * m_columns + col ) ] ) )
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+private:
+    // leaves the range empty if the rect is outside the map
+    void get_cell_range( const QRect& rect, int& first_row, int& first_col, int& last_row, int& last_col ) const noexcept;
+
+private:
+    std::vector< map_tile_node > m_nodes;
+    traversability_map m_traversability;
+    int m_rows{ 0 };
+    int m_columns{ 0 };
+    QSize m_tile_size;
+    QPoint m_origin; // top left of the first tile
 };
 
-using map_graph = std::vector< std::unique_ptr< map_tile_node > >;
 using map_path = std::deque< map_tile_node* >;
 using map_path_key = QPair< QRect, QRect >;
 using map_paths = QHash< map_path_key, map_path >;
 
-map_tile_node& create_map_node( ecs::entity& e, int row, int col, int col_count, map_graph& graph );
-void dijkstra( size_t from, map_graph& graph, size_t col_count, map_paths& paths );
+void dijkstra( size_t from, map_graph& graph, map_paths& paths );
 
 }// game
 
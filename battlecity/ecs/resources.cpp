@@ -0,0 +1,38 @@
+#include "resources.h"
+
+#include "components.h"
+
+namespace game
+{
+
+namespace resource
+{
+
+tile_graph::tile_graph( map_graph& g, ecs::world& w ) :
+    graph( &g ),
+    m_world( &w )
+{
+    using namespace component;
+
+    m_tile_cleared_observer = m_world->on_removed< non_traversible_tile >(
+    []( ecs::entity& tile, non_traversible_tile& )
+    {
+        if( tile.has_components< tile_object, positioning >() )
+        {
+            for( map_tile_node* node : tile.get_component< positioning >() )
+            {
+                node->set_tile_type( tile.get_component< tile_object >().get_tile_type() );
+                node->set_traversible( true );
+            }
+        }
+    } );
+}
+
+tile_graph::~tile_graph()
+{
+    m_world->remove_observer( m_tile_cleared_observer );
+}
+
+}// resource
+
+}// game
@@ -0,0 +1,62 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <QRect>
+
+#include "framework/world.h"
+
+namespace game
+{
+
+class map_graph;
+
+// Singletons of a level, see ecs::world::resource()
+namespace resource
+{
+
+struct map_geometry final
+{
+    explicit map_geometry( const QRect& r ) noexcept : rect( r ){}
+    QRect rect;
+};
+
+//
+
+// Keeps the nodes of the graph in sync with the tiles as the walls get destroyed,
+// so that the graph is up to date whichever systems are running
+struct tile_graph final
+{
+    tile_graph( map_graph& g, ecs::world& w );
+    ~tile_graph();
+
+    tile_graph( const tile_graph& ) = delete;
+    tile_graph& operator=( const tile_graph& ) = delete;
+
+    map_graph* graph{ nullptr };
+
+private:
+    ecs::world* m_world{ nullptr };
+    ecs::observer_id m_tile_cleared_observer{ 0 };
+};
+
+//
+
+struct player final
+{
+    explicit player( ecs::entity& e ) noexcept : entity( &e ){}
+    ecs::entity* entity{ nullptr };
+};
+
+//
+
+struct player_base final
+{
+    explicit player_base( ecs::entity& e ) noexcept : entity( &e ){}
+    ecs::entity* entity{ nullptr };
+};
+
+}// resource
+
+}// game
+
+#endif
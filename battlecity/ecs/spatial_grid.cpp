@@ -0,0 +1,198 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "components.h"
+
+namespace game
+{
+
+bool spatial_grid::cell_range::operator==( const cell_range& other ) const noexcept
+{
+    return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+}
+
+spatial_grid::spatial_grid( const QRect& area, const QSize& cell_size ) :
+    m_area( area ),
+    m_cell_size( cell_size )
+{
+    if( m_cell_size.width() <= 0 || m_cell_size.height() <= 0 )
+    {
+        throw std::invalid_argument{ "Cell size must be positive" };
+    }
+
+    m_columns = std::max( 1, ( m_area.width() + m_cell_size.width() - 1 ) / m_cell_size.width() );
+    m_rows = std::max( 1, ( m_area.height() + m_cell_size.height() - 1 ) / m_cell_size.height() );
+    m_cells.resize( static_cast< size_t >( m_columns * m_rows ) );
+}
+
+void spatial_grid::rebuild( ecs::world& world )
+{
+    clear();
+
+    world.for_each_with< component::geometry >( [ this ]( ecs::entity& e, component::geometry& geom )
+    {
+        insert( e, geom.get_rect() );
+        return true;
+    } );
+
+    m_synced_tick = world.get_change_tick() - 1;
+}
+
+void spatial_grid::sync( ecs::world& world )
+{
+    world.for_each_changed_since< component::geometry >( m_synced_tick,
+    [ this ]( ecs::entity& e, component::geometry& geom )
+    {
+        update( e, geom.get_rect() );
+        return true;
+    } );
+
+    // changes of the current tick may still be going on, so they are visited again by the next sync
+    m_synced_tick = world.get_change_tick() - 1;
+}
+
+void spatial_grid::insert( ecs::entity& e, const QRect& rect )
+{
+    if( e.has_component< component::tile_object >() || e.has_component< component::game_map >() )
+    {
+        return;
+    }
+
+    auto it = m_item_indices.find( e.get_id() );
+    if( it != m_item_indices.end() )
+    {
+        update( e, rect );
+        return;
+    }
+
+    size_t index{ m_items.size() };
+    if( !m_free_items.empty() )
+    {
+        index = m_free_items.back();
+        m_free_items.pop_back();
+    }
+    else
+    {
+        m_items.emplace_back();
+    }
+
+    item& i = m_items[ index ];
+    i.entity = &e;
+    i.rect = rect;
+    i.cells = get_cells( rect );
+
+    add_to_cells( index );
+    m_item_indices.emplace( e.get_id(), index );
+}
+
+void spatial_grid::update( const ecs::entity& e, const QRect& rect )
+{
+    auto it = m_item_indices.find( e.get_id() );
+    if( it == m_item_indices.end() )
+    {
+        return;
+    }
+
+    item& i = m_items[ it->second ];
+    i.rect = rect;
+
+    const cell_range cells{ get_cells( rect ) };
+    if( !( cells == i.cells ) )
+    {
+        remove_from_cells( it->second );
+        i.cells = cells;
+        add_to_cells( it->second );
+    }
+}
+
+void spatial_grid::remove( const ecs::entity& e )
+{
+    auto it = m_item_indices.find( e.get_id() );
+    if( it == m_item_indices.end() )
+    {
+        return;
+    }
+
+    remove_from_cells( it->second );
+    m_items[ it->second ] = item{};
+    m_free_items.emplace_back( it->second );
+    m_item_indices.erase( it );
+}
+
+bool spatial_grid::contains( const ecs::entity& e ) const
+{
+    return m_item_indices.count( e.get_id() ) != 0;
+}
+
+void spatial_grid::clear()
+{
+    for( auto& cell : m_cells )
+    {
+        cell.clear();
+    }
+
+    m_items.clear();
+    m_free_items.clear();
+    m_item_indices.clear();
+}
+
+spatial_grid::cell_range spatial_grid::get_cells( const QRect& rect ) const noexcept
+{
+    auto to_cell = []( int coord, int origin, int cell_size, int cells_count )
+    {
+        // floor division, so that the coords left/above the area don't end up in the first cell by accident
+        int offset{ coord - origin };
+        int cell{ offset >= 0? offset / cell_size : ( offset - cell_size + 1 ) / cell_size };
+        return std::min( std::max( cell, 0 ), cells_count - 1 );
+    };
+
+    cell_range range;
+    if( rect.isEmpty() )
+    {
+        return range;
+    }
+
+    range.left = to_cell( rect.left(), m_area.left(), m_cell_size.width(), m_columns );
+    range.right = to_cell( rect.right(), m_area.left(), m_cell_size.width(), m_columns );
+    range.top = to_cell( rect.top(), m_area.top(), m_cell_size.height(), m_rows );
+    range.bottom = to_cell( rect.bottom(), m_area.top(), m_cell_size.height(), m_rows );
+
+    return range;
+}
+
+void spatial_grid::add_to_cells( size_t index )
+{
+    const cell_range& range = m_items[ index ].cells;
+
+    for( int row{ range.top }; row <= range.bottom; ++row )
+    {
+        for( int col{ range.left }; col <= range.right; ++col )
+        {
+            m_cells[ row * m_columns + col ].emplace_back( index );
+        }
+    }
+}
+
+void spatial_grid::remove_from_cells( size_t index )
+{
+    const cell_range& range = m_items[ index ].cells;
+
+    for( int row{ range.top }; row <= range.bottom; ++row )
+    {
+        for( int col{ range.left }; col <= range.right; ++col )
+        {
+            std::vector< size_t >& cell = m_cells[ row * m_columns + col ];
+
+            auto it = std::find( cell.begin(), cell.end(), index );
+            if( it != cell.end() )
+            {
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+}// game
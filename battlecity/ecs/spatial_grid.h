@@ -0,0 +1,109 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#include <QRect>
+#include <QSize>
+
+#include "framework/world.h"
+
+namespace game
+{
+
+// Uniform grid of the object rects, used to find the objects near some area
+// without going over all of them. Tiles and the map aren't indexed, see map_graph for them.
+// Stored as a world resource, movement_system keeps it up to date. The grid mirrors the geometry
+// components, so the systems querying it declare reads< geometry > and the ones updating it writes< geometry >.
+// Queries don't modify the grid, so they may run concurrently
+class spatial_grid final
+{
+public:
+    spatial_grid( const QRect& area, const QSize& cell_size );
+
+    // Indexes all the objects of the world from scratch
+    void rebuild( ecs::world& world );
+
+    // Updates the rects of the objects whose geometry has changed since the last sync
+    void sync( ecs::world& world );
+
+    // Does nothing for tiles and the map. Rects outside the area go to the border cells
+    void insert( ecs::entity& e, const QRect& rect );
+    void update( const ecs::entity& e, const QRect& rect );
+    void remove( const ecs::entity& e );
+    bool contains( const ecs::entity& e ) const;
+
+    void clear();
+
+    // func should be of signature bool( ecs::entity&, const QRect& ) and is called once for every
+    // object intersecting the rect. Returning false stops the query. func shouldn't modify the grid
+    template< typename func_type >
+    void query_aabb( const QRect& rect, func_type&& func ) const
+    {
+        const cell_range range{ get_cells( rect ) };
+
+        for( int row{ range.top }; row <= range.bottom; ++row )
+        {
+            for( int col{ range.left }; col <= range.right; ++col )
+            {
+                for( size_t index : m_cells[ row * m_columns + col ] )
+                {
+                    const item& i = m_items[ index ];
+
+                    // objects spanning several cells are only reported by the first cell shared with the range
+                    if( row != std::max( range.top, i.cells.top ) || col != std::max( range.left, i.cells.left ) )
+                    {
+                        continue;
+                    }
+
+                    if( i.rect.intersects( rect ) && !func( *i.entity, i.rect ) )
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    struct cell_range final
+    {
+        int left{ 0 };
+        int top{ 0 };
+        int right{ -1 };
+        int bottom{ -1 };
+
+        bool operator==( const cell_range& other ) const noexcept;
+    };
+
+    struct item final
+    {
+        ecs::entity* entity{ nullptr };
+        QRect rect;
+        cell_range cells;
+    };
+
+    cell_range get_cells( const QRect& rect ) const noexcept;
+    void add_to_cells( size_t index );
+    void remove_from_cells( size_t index );
+
+private:
+    QRect m_area;
+    QSize m_cell_size;
+    int m_columns{ 0 };
+    int m_rows{ 0 };
+
+    std::vector< std::vector< size_t > > m_cells; // indices of m_items, row by row
+    std::vector< item > m_items;
+    std::vector< size_t > m_free_items;
+    std::unordered_map< ecs::entity_id, size_t > m_item_indices;
+
+    uint64_t m_synced_tick{ 0 };
+};
+
+}// game
+
+#endif
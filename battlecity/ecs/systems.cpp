@@ -4,6 +4,7 @@
 #include <cassert>
 #include <algorithm>
 
+#include "resources.h"
 #include "entity_factory.h"
 #include "framework/details/rw_lock_guard.h"
 
@@ -48,23 +49,49 @@ object_type get_object_type( const ecs::entity& entity )
     return result;
 }
 
-movement_system::movement_system( ecs::world& world ): ecs::system( world ){}
-
-void movement_system::init()
+movement_system::movement_system( ecs::world& world ): ecs::system( world )
 {
-    auto map_entities = m_world.get_entities_with_components< component::game_map >();
-    if( map_entities.size() != 1 )
+    using namespace component;
+
+    reads< flying, projectile, non_traversible_object, non_traversible_tile, powerup_animations >();
+    writes< movement, geometry, positioning >();
+    emits< event::projectile_collision, event::geometry_changed >();
+
+    m_world.subscribe< event::move_direction_requested >( *this );
+
+    m_geometry_added_observer = m_world.on_added< geometry >( [ this ]( ecs::entity& e, geometry& geom )
     {
-        throw std::logic_error{ "Exactly one map entity should exist" };
-    }
+        if( m_world.has_resource< spatial_grid >() )
+        {
+            m_world.resource< spatial_grid >().insert( e, geom.get_rect() );
+        }
+    } );
+
+    m_geometry_removed_observer = m_world.on_removed< geometry >( [ this ]( ecs::entity& e, geometry& )
+    {
+        if( m_world.has_resource< spatial_grid >() )
+        {
+            m_world.resource< spatial_grid >().remove( e );
+        }
+    } );
+}
 
-    ecs::entity* map_entity{ map_entities.front() };
-    m_map_geom = &map_entity->get_component_unsafe< component::geometry >();
+movement_system::~movement_system()
+{
+    m_world.unsubscribe< event::move_direction_requested >( *this );
+    m_world.remove_observer( m_geometry_added_observer );
+    m_world.remove_observer( m_geometry_removed_observer );
+}
+
+void movement_system::init()
+{
+    m_map_rect = m_world.resource< resource::map_geometry >().rect;
+    m_grid = &m_world.resource< spatial_grid >();
 }
 
 QRect calc_move( component::movement& move,
                  component::geometry& obj_geom,
-                 component::geometry& map_geom,
+                 const QRect& map_rect,
                  bool is_flying ) noexcept
 {
     int x_mult{ 0 };
@@ -104,7 +131,6 @@ QRect calc_move( component::movement& move,
     if( !is_flying )
     {
         bool on_border{ false };
-        QRect map_rect{ map_geom.get_rect() };
         if( obj_rect.left() < map_rect.left() )
         {
             obj_rect.moveLeft( map_rect.left() );
@@ -136,112 +162,111 @@ QRect calc_move( component::movement& move,
     return obj_rect;
 }
 
-map_tile_node* get_node_by_direction( const map_tile_node& parent_node,
-                                      const movement_direction& direction ) noexcept
+bool is_closer( const QRect& l, const QRect& r, const movement_direction& direction ) noexcept
 {
-    map_tile_node* result{ nullptr };
-    if( direction == movement_direction::left )
-    {
-        result = parent_node.get_left();
-    }
-    else if( direction == movement_direction::right )
-    {
-        result = parent_node.get_right();
-    }
-    else if( direction == movement_direction::up )
-    {
-        result = parent_node.get_top();
-    }
-    else if( direction == movement_direction::down )
+    bool result{ false };
+
+    switch( direction )
     {
-        result = parent_node.get_bottom();
+    case movement_direction::left: result = l.left() > r.left(); break;
+    case movement_direction::right: result = l.left() < r.left(); break;
+    case movement_direction::up: result = l.top() > r.top(); break;
+    case movement_direction::down: result = l.top() < r.top(); break;
+    default: break;
     }
 
     return result;
 }
 
-std::pair< bool, ecs::entity* >
-movement_system::validate_movement( ecs::entity& curr_entity,
-                                    component::movement& move,
-                                    const QRect& new_position,
-                                    component::positioning& pos )
+// Scans the tile bitmap in the direction from every node( one per lane of the grid ) up to the first
+// non traversible tile and returns the nearest of them, or nullptr if all the lanes lead out of the map
+map_tile_node* predict_impact_node( const component::positioning& pos, const movement_direction& direction )
 {
-    using namespace component;
-
-    std::pair< bool, ecs::entity* > result{ true, nullptr };
+    map_tile_node* result{ nullptr };
 
-    std::unordered_set< map_tile_node* >& nodes = pos.get_nodes();
-    const movement_direction& direction = move.get_move_direction();
+    map_graph* graph{ pos.get_graph() };
+    if( !graph )
+    {
+        return result;
+    }
 
-    // Check nodes
-    std::list< map_tile_node* > new_nodes;
-    std::list< map_tile_node* > nodes_to_erase;
+    const traversability_map& traversability = graph->get_traversability();
 
-    for( auto it = nodes.begin(); it != nodes.end(); )
+    for( map_tile_node* lane_node : pos )
     {
-        map_tile_node* node = *it;
+        int row{ lane_node->get_row() };
+        int col{ lane_node->get_col() };
 
-        map_tile_node* maybe_obstacle{ get_node_by_direction( *node, direction ) };
-        if( maybe_obstacle )
+        switch( direction )
         {
-            ecs::entity& obstacle_tile = maybe_obstacle->get_entity();
-            geometry& obstacle_geom = obstacle_tile.get_component< geometry >();
-
-            if( obstacle_geom.intersects_with( new_position ) )
-            {
-                if( obstacle_tile.has_component< non_traversible_tile >() )
-                {
-                    if( maybe_obstacle )
-                    result.first = false;
-                    result.second = &maybe_obstacle->get_entity();
-                    break;
-                }
-                else
-                {
-                    new_nodes.emplace_back( maybe_obstacle );
-                }
-            }
+        case movement_direction::left: col = traversability.find_blocked_in_row( cell_layer::tiles, row, col - 1, false ); break;
+        case movement_direction::right: col = traversability.find_blocked_in_row( cell_layer::tiles, row, col + 1, true ); break;
+        case movement_direction::up: row = traversability.find_blocked_in_column( cell_layer::tiles, col, row - 1, false ); break;
+        case movement_direction::down: row = traversability.find_blocked_in_column( cell_layer::tiles, col, row + 1, true ); break;
+        default: row = -1; break;
         }
 
-        geometry& node_geom = node->get_entity().get_component< geometry >();
-        if( node_geom.intersects_with( new_position ) )
-        {
-            ++it;
-        }
-        else
+        map_tile_node* node{ graph->get_node( row, col ) };
+        if( node && ( !result || is_closer( node->get_rect(), result->get_rect(), direction ) ) )
         {
-            nodes_to_erase.emplace_back( *(it++) );
+            result = node;
         }
     }
 
-    if( result.first )
+    return result;
+}
+
+ecs::entity* movement_system::find_obstacle( const QRect& area,
+                                             const ecs::entity& curr_entity,
+                                             ecs::entity_id ignored_id )
+{
+    using namespace component;
+
+    ecs::entity* obstacle{ nullptr };
+
+    m_grid->query_aabb( area, [ & ]( ecs::entity& e, const QRect& )
     {
-        for( map_tile_node* node_to_erase : nodes_to_erase )
+        if( e != curr_entity && e.get_id() != ignored_id && e.has_component< non_traversible_object >() )
         {
-            pos.remove_node( *node_to_erase );
+            obstacle = &e;
         }
 
-        for( map_tile_node* new_node : new_nodes )
-        {
-            pos.add_node( *new_node );
-        }
+        return obstacle == nullptr;
+    } );
+
+    return obstacle;
+}
 
-        // Check objects
+std::pair< bool, ecs::entity* >
+movement_system::validate_movement( ecs::entity& curr_entity,
+                                    const QRect& new_position,
+                                    const component::positioning& pos )
+{
+    std::pair< bool, ecs::entity* > result{ true, nullptr };
 
-        if( m_map_geom->get_rect().contains( new_position ) )
+    // Check tiles, the blocking one is only looked for once the bitmap says there is one
+    map_graph* graph{ pos.get_graph() };
+    if( graph && !graph->is_free( new_position, cell_layer::tiles ) )
+    {
+        graph->for_each_node_in( new_position, [ & ]( map_tile_node& node )
         {
-            m_world.for_each_with< non_traversible_object, geometry >( [ & ]( ecs::entity& e,
-                                                                     non_traversible_object&,
-                                                                     geometry& obstacle_geom )
+            if( !node.is_traversible() )
             {
-                if( e != curr_entity && new_position.intersects( obstacle_geom.get_rect() ) )
-                {
-                    result.first = false;
-                    result.second = &e;
-                }
+                result.first = false;
+                result.second = &node.get_entity();
+            }
 
-                return result.first;
-            } );
+            return result.first;
+        } );
+    }
+
+    // Check objects
+    if( result.first )
+    {
+        if( m_map_rect.contains( new_position ) )
+        {
+            result.second = find_obstacle( new_position, curr_entity );
+            result.first = result.second == nullptr;
         }
         else
         {
@@ -252,16 +277,52 @@ movement_system::validate_movement( ecs::entity& curr_entity,
     return result;
 }
 
+std::pair< bool, ecs::entity* >
+movement_system::validate_projectile_movement( ecs::entity& curr_entity,
+                                               const QRect& old_position,
+                                               const QRect& new_position )
+{
+    using namespace component;
+
+    std::pair< bool, ecs::entity* > result{ true, nullptr };
+
+    const projectile& proj = curr_entity.get_component< projectile >();
+    map_tile_node* impact_node{ proj.get_impact_node() };
+
+    // the whole way covered by the step, so that a fast projectile can't jump over a thin obstacle
+    QRect corridor{ old_position.united( new_position ) };
+
+    if( impact_node && corridor.intersects( impact_node->get_rect() ) )
+    {
+        result.first = false;
+        result.second = &impact_node->get_entity();
+    }
+    else if( m_map_rect.contains( new_position ) )
+    {
+        result.second = find_obstacle( corridor, curr_entity, proj.get_shooter_id() );
+        result.first = result.second == nullptr;
+    }
+    else
+    {
+        result.first = false;
+    }
+
+    return result;
+}
+
 bool movement_system::tick()
 {
     using namespace component;
 
+    // catch up with the objects moved by the other systems
+    m_grid->sync( m_world );
+
     m_world.for_each_with< movement, geometry, positioning >( [ & ]( ecs::entity& curr_entity,
                                                               movement& move,
                                                               geometry& curr_geom,
                                                               positioning& curr_pos )
     {
-        ecs::rw_lock_guard< ecs::rw_lock > l{ move, ecs::lock_mode::write };
+        ecs::lock_guard_for< component::movement > l{ move, ecs::lock_mode::write };
 
         if( move.get_move_direction() != movement_direction::none )
         {
@@ -271,14 +332,17 @@ bool movement_system::tick()
             QRect rect_after_move;
 
             {
-                ecs::rw_lock_guard< ecs::rw_lock > l{ curr_geom, ecs::lock_mode::write };
+                ecs::lock_guard_for< component::geometry > l{ curr_geom, ecs::lock_mode::write };
 
                 int prev_rotation{ curr_geom.get_rotation() };
                 bool is_flying{ curr_entity.has_component< flying >() };
                 bool movement_valid{ true };
 
-                rect_after_move = calc_move( move, curr_geom, *m_map_geom, is_flying );
-                auto is_valid_and_obstacle = validate_movement( curr_entity, move, rect_after_move, curr_pos );
+                rect_after_move = calc_move( move, curr_geom, m_map_rect, is_flying );
+                bool is_projectile{ curr_entity.has_component< projectile >() };
+                auto is_valid_and_obstacle = is_projectile?
+                        validate_projectile_movement( curr_entity, curr_geom.get_rect(), rect_after_move ) :
+                        validate_movement( curr_entity, rect_after_move, curr_pos );
 
                 if( !is_flying )
                 {
@@ -318,16 +382,27 @@ bool movement_system::tick()
                     x_changed = curr_geom.get_pos().x() != rect_after_move.x();
                     y_changed = curr_geom.get_pos().y() != rect_after_move.y();
                     curr_geom.set_pos( rect_after_move.topLeft() );
+                    m_grid->update( curr_entity, curr_geom.get_rect() );
+
+                    // projectiles keep the nodes they were fired from, see predict_impact_node()
+                    if( !is_projectile && ( x_changed || y_changed ) )
+                    {
+                        curr_pos.set_nodes_in( rect_after_move );
+                        curr_entity.mark_changed< positioning >();
+                    }
                 }
                 else
                 {
                     move.set_move_direction( movement_direction::none );
+                    curr_entity.mark_changed< movement >();
                 }
             }
 
             // Emit position update events
             if( x_changed || y_changed || rotation_changed )
             {
+                curr_entity.mark_changed< geometry >();
+
                 event::geometry_changed event{ x_changed, y_changed, rotation_changed };
                 event.set_cause_entity( curr_entity );
                 m_world.emit_event( event );
@@ -342,8 +417,9 @@ bool movement_system::tick()
                         {
                             ecs::entity& anim_entity = *anim_pair.second;
 
-                            geometry& anim_geom = anim_entity.get_component< geometry >();
+                            geometry& anim_geom = anim_entity.get_component_mut< geometry >();
                             anim_geom.move_center_to( rect_after_move.center() );
+                            m_grid->update( anim_entity, anim_geom.get_rect() );
 
                             event::geometry_changed anim_event{ x_changed, y_changed, false };
                             anim_event.set_cause_entity( anim_entity );
@@ -363,7 +439,22 @@ bool movement_system::tick()
 
 void movement_system::clean()
 {
-    m_map_geom = nullptr;
+    m_map_rect = QRect{};
+    m_grid = nullptr;
+}
+
+void movement_system::on_event( const event::move_direction_requested& event )
+{
+    if( m_world.entity_present( event.get_entity_id() ) )
+    {
+        ecs::entity& e = m_world.get_entity( event.get_entity_id() );
+        if( e.has_component< component::movement >() )
+        {
+            component::movement& move = e.get_component_mut< component::movement >();
+            ecs::lock_guard_for< component::movement > l{ move, ecs::lock_mode::write };
+            move.set_move_direction( event.get_direction() );
+        }
+    }
 }
 
 //
@@ -377,24 +468,48 @@ projectile_system::projectile_system( const QSize& projectile_size,
     m_damage( projectile_damage ),
     m_speed( projectile_speed )
 {
+    using namespace component;
+
+    reads< projectile, geometry, positioning, movement >();
+    writes< health, shield, graphics, tile_object, kills_counter, turret_object, powerup_animations, animation_info >();
+    emits< event::graphics_changed, event::entity_killed, event::entity_hit, event::entities_removed >();
+
     m_world.subscribe< event::projectile_collision >( *this );
 }
 
 projectile_system::~projectile_system()
 {
     m_world.unsubscribe< event::projectile_collision >( *this );
+    m_world.remove_observer( m_tile_cleared_observer );
 }
 
 void projectile_system::init()
 {
-    auto map_entities = m_world.get_entities_with_components< component::game_map >();
-    if( map_entities.size() != 1 )
+    using namespace component;
+
+    // registered after the observer of resource::tile_graph, so that the graph is already updated
+    m_world.remove_observer( m_tile_cleared_observer );
+    m_tile_cleared_observer = m_world.on_removed< non_traversible_tile >(
+    [ this ]( ecs::entity& tile, non_traversible_tile& )
     {
-        throw std::logic_error{ "Exactly one map entity should exist" };
-    }
+        m_world.for_each_with< projectile, movement, positioning >(
+        [ & ]( ecs::entity&, projectile& proj, movement& move, positioning& pos )
+        {
+            map_tile_node* impact_node{ proj.get_impact_node() };
+            if( impact_node && &impact_node->get_entity() == &tile )
+            {
+                proj.set_impact_node( predict_impact_node( pos, move.get_move_direction() ) );
+            }
+
+            return true;
+        } );
+    } );
+}
 
-    ecs::entity* map_entity{ map_entities.front() };
-    m_map_geom = &map_entity->get_component_unsafe< component::geometry >();
+void projectile_system::clean()
+{
+    m_world.remove_observer( m_tile_cleared_observer );
+    m_tile_cleared_observer = 0;
 }
 
 bool projectile_system::tick()
@@ -405,11 +520,6 @@ bool projectile_system::tick()
     return true;
 }
 
-void projectile_system::clean()
-{
-    m_map_geom = nullptr;
-}
-
 void projectile_system::on_event( const event::projectile_collision& event )
 {
     m_collisions.emplace_back( event );
@@ -424,14 +534,16 @@ void projectile_system::kill_entity( ecs::entity& victim,
 
     bool count_kill{ false };
 
-    victim.remove_components< non_traversible_tile, non_traversible_object >();
+    // structural changes are deferred until the next sync point of the world
+    ecs::command_buffer& commands = m_world.get_command_buffer();
+    commands.remove_components< non_traversible_tile, non_traversible_object >( victim.get_id() );
 
     if( victim.has_component< graphics >() )
     {
         bool image_changed{ false };
         bool visibility_changed{ false };
 
-        graphics& entity_graphics = victim.get_component< graphics >();
+        graphics& entity_graphics = victim.get_component_mut< graphics >();
 
         if( victim_type == object_type::player_tank ||
             victim_type == object_type::enemy_tank ||
@@ -443,8 +555,8 @@ void projectile_system::kill_entity( ecs::entity& victim,
         }
         else if( victim_type == object_type::tile )
         {
-            victim.remove_component< health >();
-            victim.get_component< tile_object >().set_tile_type( tile_type::empty );
+            commands.remove_components< health >( victim.get_id() );
+            victim.get_component_mut< tile_object >().set_tile_type( tile_type::empty );
             entity_graphics.set_image_path( tile_image_path( tile_type::empty ) );
             image_changed = true;
         }
@@ -458,7 +570,7 @@ void projectile_system::kill_entity( ecs::entity& victim,
     {
         if( killer && killer->has_component< kills_counter >() )
         {
-            killer->get_component< kills_counter >().increase( 1 );
+            killer->get_component_mut< kills_counter >().increase( 1 );
         }
 
         event::entity_killed event{ victim_type, victim, killer_type, killer };
@@ -486,7 +598,7 @@ void projectile_system::handle_obstacle( ecs::entity& obstacle,
     // Damage obstacle if it has health or/and shield
     if( obstacle.has_component< shield >() )
     {
-        shield& obstacle_shield = obstacle.get_component< shield >();
+        shield& obstacle_shield = obstacle.get_component_mut< shield >();
         uint32_t shield_power{ obstacle_shield.get_shield_health() };
         obstacle_shield.decrease( damage_to_do );
 
@@ -495,24 +607,24 @@ void projectile_system::handle_obstacle( ecs::entity& obstacle,
 
         if( !obstacle_shield.has_shield() )
         {
-            obstacle.remove_component< shield >();
+            m_world.get_command_buffer().remove_components< shield >( obstacle.get_id() );
         }
 
         if( obstacle.has_component< powerup_animations >() )
         {
             powerup_animations& animations_comp =
-                    obstacle.get_component< powerup_animations >();
+                    obstacle.get_component_mut< powerup_animations >();
 
             ecs::entity& anim_entity = animations_comp.get_animation( powerup_type::shield );
-            anim_entity.get_component< animation_info >().force_stop();
+            anim_entity.get_component_mut< animation_info >().force_stop();
             animations_comp.remove_animation( powerup_type::shield );
         }
     }
 
     if( damage_to_do && obstacle.has_component< health >() )
     {
-        health& obstacle_health = obstacle.get_component< health >();
-        ecs::rw_lock_guard< ecs::rw_lock > l{ obstacle_health, ecs::lock_mode::write };
+        health& obstacle_health = obstacle.get_component_mut< health >();
+        ecs::lock_guard_for< component::health > l{ obstacle_health, ecs::lock_mode::write };
 
         obstacle_health.decrease( projectile_component.get_damage() );
         if( !obstacle_health.alive() )
@@ -583,72 +695,100 @@ void projectile_system::create_new_projectiles()
 {
     using namespace component;
 
+    ecs::command_buffer& commands = m_world.get_command_buffer();
+
     m_world.for_each_with< turret_object, geometry >(
     [ & ]( ecs::entity& turret_entity, turret_object& turret_info, geometry& tank_geom )
     {
-        ecs::entity* proj_entity{ nullptr };
+        ecs::lock_guard_for< component::turret_object > l{ turret_info, ecs::lock_mode::write };
 
+        if( turret_info.has_fired() )
         {
-            ecs::rw_lock_guard< ecs::rw_lock > l{ turret_info, ecs::lock_mode::write };
+            QRect projectile_rect{ get_projectile_rect( tank_geom.get_rect(), m_projectile_size ) };
+            movement_direction direction{ get_direction_by_rotation( tank_geom.get_rotation() ) };
 
-            if( turret_info.has_fired() )
+            // the projectile is created at the sync point, unless the shooter is gone by then
+            commands.apply( turret_entity.get_id(), [ this, projectile_rect, direction ]( ecs::entity& shooter )
             {
-                QRect projectile_rect{ get_projectile_rect( tank_geom.get_rect(), m_projectile_size ) };
-
-                movement_direction direction{ get_direction_by_rotation( tank_geom.get_rotation() ) };
-                projectile_params params
-                {
-                    projectile_rect,
-                    m_damage,
-                    m_speed,
-                    direction,
-                    turret_entity
-                };
-
-                ecs::entity& entity = create_entity_projectile( params, m_world );
-
-                turret_info.set_fire_status( false );
-                proj_entity = &entity;
-            }
-        }
+                create_projectile( shooter, projectile_rect, direction );
+            } );
 
-        if( proj_entity )
-        {
-            event::projectile_fired event{ turret_entity, *proj_entity };
-            m_world.emit_event( event );
+            turret_info.set_fire_status( false );
+            turret_entity.mark_changed< turret_object >();
         }
 
         return true;
     } );
 }
 
+void projectile_system::create_projectile( ecs::entity& shooter,
+                                           const QRect& rect,
+                                           const movement_direction& direction )
+{
+    using namespace component;
+
+    projectile_params params
+    {
+        rect,
+        m_damage,
+        m_speed,
+        direction,
+        shooter
+    };
+
+    ecs::entity& entity = create_entity_projectile( params, m_world );
+
+    // the walls don't move, so the one the projectile hits is known right away
+    entity.get_component_mut< projectile >().set_impact_node(
+                predict_impact_node( entity.get_component< positioning >(), direction ) );
+
+    event::projectile_fired event{ shooter, entity };
+    m_world.emit_event( event );
+}
+
 //
 
 respawn_system::respawn_system(ecs::world& world ) noexcept : ecs::system( world )
 {
+    using namespace component;
+
+    reads< respawn_delay, non_traversible_object >();
+    writes< lifes, health, power_up, graphics, geometry, positioning >();
+    emits< event::geometry_changed, event::graphics_changed, event::entity_respawned >();
+
     m_world.subscribe< event::entity_killed >( *this );
     m_world.subscribe< event::powerup_taken >( *this );
+
+    // objects stop and start blocking the cells as they die and respawn
+    m_object_added_observer = m_world.on_added< non_traversible_object >(
+    [ this ]( ecs::entity& e, non_traversible_object& )
+    {
+        if( m_graph && e.has_component< positioning >() )
+        {
+            set_object_cells( e.get_id(), &e.get_component< positioning >() );
+        }
+    } );
+
+    m_object_removed_observer = m_world.on_removed< non_traversible_object >(
+    [ this ]( ecs::entity& e, non_traversible_object& )
+    {
+        if( m_graph )
+        {
+            set_object_cells( e.get_id(), nullptr );
+        }
+    } );
 }
 
 respawn_system::~respawn_system()
 {
     m_world.unsubscribe< event::entity_killed >( *this );
     m_world.unsubscribe< event::powerup_taken >( *this );
+    m_world.remove_observer( m_object_added_observer );
+    m_world.remove_observer( m_object_removed_observer );
 }
 
 void respawn_system::init()
 {
-    std::list< ecs::entity* > tiles{
-        m_world.get_entities_with_components< component::tile_object >() };
-
-    for( const ecs::entity* e : tiles )
-    {
-        if( e->get_component< component::tile_object >().get_tile_type() == tile_type::empty )
-        {
-            m_empty_tiles.emplace_back( e );
-        }
-    }
-
     auto enemies = m_world.get_entities_with_components< component::enemy >();
     for( ecs::entity* enemy : enemies )
     {
@@ -661,11 +801,24 @@ void respawn_system::init()
     {
         m_death_info.emplace_back( death_info{ enemy, curr_time } );
     }
+
+    m_graph = m_world.resource< resource::tile_graph >().graph;
+    m_cell_objects.assign( m_graph->size(), 0 );
+    m_graph->get_traversability().clear( cell_layer::objects );
+
+    m_world.for_each_with< component::non_traversible_object, component::positioning >(
+    [ this ]( ecs::entity& e, component::non_traversible_object&, component::positioning& pos )
+    {
+        set_object_cells( e.get_id(), &pos );
+        return true;
+    } );
+
+    m_synced_tick = m_world.get_change_tick() - 1;
 }
 
 bool respawn_system::tick()
 {
-    if( !m_empty_tiles.empty() && !m_death_info.empty()  )
+    if( !m_death_info.empty() )
     {
         std::vector< const ecs::entity* > free_respawns{ get_free_respawns() };
         respawn_if_ready( m_death_info, free_respawns );
@@ -676,8 +829,12 @@ bool respawn_system::tick()
 
 void respawn_system::clean()
 {
-    m_empty_tiles.clear();
+    m_free_cells.clear();
     m_death_info.clear();
+    m_object_cells.clear();
+    m_cell_objects.clear();
+    m_graph = nullptr;
+    m_synced_tick = 0;
 }
 
 void respawn_system::on_event( const event::entity_killed& event )
@@ -697,8 +854,8 @@ void respawn_system::maybe_add_to_respawn_list( ecs::entity& e )
     // If entity still has a spare life, shedule it's respawn
     if( e.has_components< lifes, respawn_delay >() )
     {
-        lifes& lifes_component = e.get_component< lifes >();
-        ecs::rw_lock_guard< ecs::rw_lock > l{ lifes_component, ecs::lock_mode::write };
+        lifes& lifes_component = e.get_component_mut< lifes >();
+        ecs::lock_guard_for< component::lifes > l{ lifes_component, ecs::lock_mode::write };
 
         if( lifes_component.has_life() )
         {
@@ -716,7 +873,7 @@ void respawn_system::respawn_if_ready( std::list< death_info >& list,
 
     auto curr_time = clock::now();
 
-    for( auto it = list.begin(); it!=  list.end(); )
+    for( auto it = list.begin(); it!=  list.end() && !free_respawns.empty(); )
     {
         const death_info& info = *it;
         auto passed_since_death = duration_cast< milliseconds >( curr_time - info.death_time );
@@ -743,36 +900,38 @@ void respawn_system::respawn_entity( ecs::entity& entity, const ecs::entity& res
     using namespace component;
 
     {
-        ecs::rw_lock_guard< ecs::rw_lock > l{ entity, ecs::lock_mode::write };
+        ecs::lock_guard_for< ecs::entity > l{ entity, ecs::lock_mode::write };
 
         if( entity.has_component< tank_object >() )
         {
-            health& entity_health = entity.get_component< health >();
+            health& entity_health = entity.get_component_mut< health >();
             entity_health.increase( entity_health.get_max_health() );
-            entity.add_component< non_traversible_object >();
+            m_world.get_command_buffer().add_component< non_traversible_object >( entity.get_id() );
         }
         else if( entity.has_component< power_up >() )
         {
-            entity.get_component< power_up >().
+            entity.get_component_mut< power_up >().
                     set_state( power_up::state::active );
         }
 
-        entity.get_component< graphics >().set_visible( true );
+        entity.get_component_mut< graphics >().set_visible( true );
 
-        geometry& entity_geom = entity.get_component< geometry >();
+        geometry& entity_geom = entity.get_component_mut< geometry >();
         QRect entity_rect{ entity_geom.get_rect() };
 
         entity_rect.moveCenter( respawn.get_component< geometry >().get_rect().center() );
         entity_geom.set_rect( entity_rect );
 
-        positioning& entity_pos = entity.get_component< positioning >();
-        auto& nodes = entity_pos.get_nodes();
-        nodes.clear();
+        // the readers of the grid don't sync it
+        if( m_world.has_resource< spatial_grid >() )
+        {
+            m_world.resource< spatial_grid >().update( entity, entity_rect );
+        }
 
-        const positioning& respawn_pos = respawn.get_component< positioning >();
-        auto& resp_nodes = respawn_pos.get_nodes();
+        positioning& entity_pos = entity.get_component_mut< positioning >();
+        entity_pos.clear_nodes();
 
-        for( map_tile_node* node : resp_nodes )
+        for( map_tile_node* node : respawn.get_component< positioning >() )
         {
             entity_pos.add_node( *node );
         }
@@ -798,71 +957,110 @@ std::vector< const ecs::entity* > respawn_system::get_free_respawns()
 
     std::vector< const ecs::entity* > free_respawns;
 
-    static std::mt19937 rng{ std::random_device{}() };
-    std::uniform_int_distribution< size_t >dist( 0, m_empty_tiles.size() - 1 );
+    map_graph& graph = *m_graph;
 
-    for( size_t num{ 0 }; num < m_death_info.size(); ++num )
+    // only the objects which have moved since the last time are put to the other cells
+    m_world.for_each_changed_since< positioning, non_traversible_object >( m_synced_tick,
+    [ this ]( ecs::entity& e, positioning& pos, non_traversible_object& )
     {
-        size_t attempt{ 0 };
-        bool respawn_free{ true };
+        set_object_cells( e.get_id(), &pos );
+        return true;
+    } );
 
-        do
-        {
-            size_t respawn_index = dist( rng );
-            const ecs::entity* curr_tile{ m_empty_tiles[ respawn_index ] };
+    m_synced_tick = m_world.get_change_tick() - 1;
 
-            m_world.for_each_with< non_traversible_object, geometry >(
-            [ & ]( ecs::entity&, non_traversible_object&, geometry& obstacle )
-            {
-                respawn_free = !obstacle.intersects_with( curr_tile->get_component< geometry >() );
+    graph.get_traversability().get_free_cells( m_free_cells );
 
-                return respawn_free;
-            } );
+    static std::mt19937 rng{ std::random_device{}() };
+    size_t respawns_count{ std::min( m_death_info.size(), m_free_cells.size() ) };
 
-            if( respawn_free )
-            {
-                free_respawns.emplace_back( curr_tile );
-            }
+    // partial shuffle, the respawns are picked at random without repeats
+    for( size_t i{ 0 }; i < respawns_count; ++i )
+    {
+        std::uniform_int_distribution< size_t > dist( i, m_free_cells.size() - 1 );
+        std::swap( m_free_cells[ i ], m_free_cells[ dist( rng ) ] );
+
+        free_respawns.emplace_back( &graph[ m_free_cells[ i ] ].get_entity() );
+    }
 
-            ++attempt;
+    return free_respawns;
+}
+
+void respawn_system::set_object_cells( ecs::entity_id id, const component::positioning* pos )
+{
+    traversability_map& traversability = m_graph->get_traversability();
+    std::vector< size_t >& cells = m_object_cells[ id ];
+
+    for( size_t cell : cells )
+    {
+        if( !--m_cell_objects[ cell ] )
+        {
+            const map_tile_node& node = ( *m_graph )[ cell ];
+            traversability.set_blocked( cell_layer::objects, node.get_row(), node.get_col(), false );
         }
-        while( !respawn_free && attempt < m_empty_tiles.size() );
     }
 
-    std::shuffle( free_respawns.begin(), free_respawns.end(), rng );
+    cells.clear();
 
-    return free_respawns;
+    if( !pos )
+    {
+        m_object_cells.erase( id );
+        return;
+    }
+
+    for( const map_tile_node* node : *pos )
+    {
+        size_t cell{ m_graph->get_index( *node ) };
+        cells.emplace_back( cell );
+
+        if( !m_cell_objects[ cell ]++ )
+        {
+            traversability.set_blocked( cell_layer::objects, node->get_row(), node->get_col(), true );
+        }
+    }
 }
 
 //
 
-powerup_system::powerup_system( ecs::world& world ) noexcept : ecs::system( world ){}
+powerup_system::powerup_system( ecs::world& world ) noexcept : ecs::system( world )
+{
+    using namespace component;
+
+    reads< health, geometry >();
+    writes< power_up, graphics >();
+    emits< event::graphics_changed, event::powerup_taken >();
+}
 
 bool powerup_system::tick()
 {
     using namespace component;
 
+    const spatial_grid& grid = m_world.resource< spatial_grid >();
+
     m_world.for_each_with< power_up, geometry >(
     [ & ]( ecs::entity& powerup_entity, power_up& powerup_comp, geometry& powerup_geom )
     {
         if( powerup_comp.get_state() == power_up::state::active )
         {
             const powerup_type& type = powerup_comp.get_type();
+            ecs::entity* taker{ nullptr };
 
-            m_world.for_each_with< tank_object, geometry >(
-            [&]( ecs::entity& tank, tank_object&, geometry& tank_geom )
+            grid.query_aabb( powerup_geom.get_rect(), [ & ]( ecs::entity& tank, const QRect& )
             {
-                bool need_to_continue{ true };
-
-                if( tank_geom.intersects_with( powerup_geom ) )
+                if( tank.has_component< tank_object >() )
                 {
-                    deactivate_powerup( powerup_entity, powerup_comp, tank );
-                    apply_powerup( type, tank );
-                    need_to_continue = false;
+                    taker = &tank;
                 }
 
-                return need_to_continue;
+                return taker == nullptr;
             } );
+
+            // the handlers of the events may change the grid, so the powerup is applied once the query is over
+            if( taker )
+            {
+                deactivate_powerup( powerup_entity, powerup_comp, *taker );
+                apply_powerup( type, *taker );
+            }
         }
 
         return true;
@@ -875,8 +1073,8 @@ void powerup_system::apply_powerup( const powerup_type& type, ecs::entity& targe
 {
     if( type == powerup_type::shield )
     {
-        target.add_component< component::shield >(
-                    target.get_component< component::health >().get_max_health() );
+        m_world.get_command_buffer().add_component< component::shield >(
+                    target.get_id(), target.get_component< component::health >().get_max_health() );
     }
 }
 
@@ -886,10 +1084,11 @@ void powerup_system::deactivate_powerup( ecs::entity& powerup,
 {
     using namespace component;
     comp.set_state( power_up::state::waiting_to_respawn );
+    powerup.mark_changed< power_up >();
 
     {
-        graphics& powerup_graphics = powerup.get_component< graphics >();
-        ecs::rw_lock_guard< ecs::rw_lock > l{ powerup_graphics, ecs::lock_mode::write };
+        graphics& powerup_graphics = powerup.get_component_mut< graphics >();
+        ecs::lock_guard_for< component::graphics > l{ powerup_graphics, ecs::lock_mode::write };
 
         powerup_graphics.set_visible( false );
     }
@@ -915,6 +1114,11 @@ win_defeat_system::win_defeat_system( uint32_t kills_to_win, ecs::world& world )
     ecs::system( world ),
     m_kills_to_win( kills_to_win )
 {
+    using namespace component;
+
+    reads< health, kills_counter, lifes, frag, enemy >();
+    writes< graphics >();
+    emits< event::level_completed, event::graphics_changed >();
     m_world.subscribe< event::entity_killed >( *this );
 }
 
@@ -934,21 +1138,8 @@ void win_defeat_system::init()
                r->get_component< component::frag >().get_num();
     } );
 
-    auto players = m_world.get_entities_with_components< component::player >();
-    if( players.size() != 1 )
-    {
-        throw std::logic_error{ "Exactly one player entity should exist" };
-    }
-
-    m_player = players.front();
-
-    auto player_bases = m_world.get_entities_with_components< component::player_base >();
-    if( player_bases.size() != 1 )
-    {
-        throw std::logic_error{ "Exactly one player base entity should exist" };
-    }
-
-    m_player_base = player_bases.front();
+    m_player = m_world.resource< resource::player >().entity;
+    m_player_base = m_world.resource< resource::player_base >().entity;
 }
 
 bool win_defeat_system::tick()
@@ -992,10 +1183,10 @@ void win_defeat_system::on_event(const event::entity_killed& event )
             uint32_t player_kills{ m_player->get_component< kills_counter >().get_kills() };
             ecs::entity* frag_entity{  m_frag_entities[ player_kills - 1 ] };
 
-            component::graphics& graphics = frag_entity->get_component< component::graphics >();
+            component::graphics& graphics = frag_entity->get_component_mut< component::graphics >();
 
             {
-                ecs::rw_lock_guard< ecs::rw_lock > l{ graphics, ecs::lock_mode::write };
+                ecs::lock_guard_for< component::graphics > l{ graphics, ecs::lock_mode::write };
                 graphics.set_visible( false );
             }
 
@@ -1013,44 +1204,39 @@ tank_ai_system::tank_ai_system( float chance_to_fire,
                                 ecs::world& world ) noexcept :
     ecs::system( world ),
     m_chance_to_fire( chance_to_fire ),
-    m_chance_to_change_direction( chance_to_change_direction ){}
+    m_chance_to_change_direction( chance_to_change_direction )
+{
+    using namespace component;
+
+    reads< enemy, health >();
+    writes< movement, turret_object >();
+}
 
 void tank_ai_system::init()
 {
     m_chance_to_change_direction = 0.03f;
-    m_enemies = m_world.get_entities_with_components< component::enemy >();
-
-    auto players = m_world.get_entities_with_components< component::player >();
-    if( players.size() != 1 )
-    {
-        throw std::logic_error{ "Exactly one player entity should exist" };
-    }
-
-    m_player = players.front();
 }
 
 
-movement_direction generate_move_direction()
+movement_direction generate_move_direction( std::mt19937& rng )
 {
-    static std::mt19937 rng{ std::random_device{}() };
-    static std::uniform_int_distribution< std::mt19937::result_type > dist{ 0, 3 };
+    std::uniform_int_distribution< std::mt19937::result_type > dist{ 0, 3 };
     return static_cast< movement_direction >( dist( rng ) );
 }
 
-bool tank_ai_system::maybe_fire()
+bool tank_ai_system::maybe_fire( std::mt19937& rng ) const
 {
-    return make_decision( m_chance_to_fire );
+    return make_decision( m_chance_to_fire, rng );
 }
 
-bool tank_ai_system::maybe_change_direction()
+bool tank_ai_system::maybe_change_direction( std::mt19937& rng ) const
 {
-    return make_decision( m_chance_to_change_direction );
+    return make_decision( m_chance_to_change_direction, rng );
 }
 
-bool tank_ai_system::make_decision( float chance ) const
+bool tank_ai_system::make_decision( float chance, std::mt19937& rng ) const
 {
-    static std::mt19937 rng{ std::random_device{}() };
-    static std::uniform_int_distribution< std::mt19937::result_type >dist{ 0, 100 };
+    std::uniform_int_distribution< std::mt19937::result_type >dist{ 0, 100 };
     return ( dist( rng ) < chance * 100 );
 }
 
@@ -1058,43 +1244,43 @@ bool tank_ai_system::tick()
 {
     using namespace component;
 
-    for( ecs::entity* enemy : m_enemies )
+    // every tank only touches its own components
+    m_world.par_for_each_with< enemy, health, movement, turret_object >( m_worker_states,
+    [ this ]( worker_state& state, ecs::entity& e, enemy&, health& enemy_health, movement& move, turret_object& enemy_turret )
     {
-        health& enemy_health = enemy->get_component< health >();
-        ecs::rw_lock_guard< ecs::rw_lock > l{ enemy_health, ecs::lock_mode::read };
+        ecs::lock_guard_for< component::health > l{ enemy_health, ecs::lock_mode::read };
 
         if( enemy_health.alive() )
         {
-            movement& move = enemy->get_component< movement >();
-            ecs::rw_lock_guard< ecs::rw_lock > lm{ move, ecs::lock_mode::write };
-
-            turret_object& enemy_turret = enemy->get_component< turret_object >();
-            ecs::rw_lock_guard< ecs::rw_lock > let{ enemy_turret, ecs::lock_mode::write };
+            ecs::lock_guard_for< component::movement > lm{ move, ecs::lock_mode::write };
+            ecs::lock_guard_for< component::turret_object > let{ enemy_turret, ecs::lock_mode::write };
 
             if( move.get_move_direction() == movement_direction::none ||
-                maybe_change_direction() )
+                maybe_change_direction( state.rng ) )
             {
-                move.set_move_direction( generate_move_direction() );
+                move.set_move_direction( generate_move_direction( state.rng ) );
+                e.mark_changed< movement >();
             }
 
-            if( !enemy_turret.has_fired() && maybe_fire() )
+            if( !enemy_turret.has_fired() && maybe_fire( state.rng ) )
             {
                 enemy_turret.set_fire_status( true );
+                e.mark_changed< turret_object >();
             }
         }
-    }
+    } );
 
     return true;
 }
 
-void tank_ai_system::clean()
-{
-    m_enemies.clear();
-    m_player = nullptr;
-}
-
 animation_system::animation_system( ecs::world& world ) noexcept : ecs::system( world )
 {
+    using namespace component;
+
+    // animation_started is emitted at the sync points, when the animations are created
+    reads< animation_info, geometry, power_up, powerup_animations >();
+    emits< event::animation_ended, event::entities_removed >();
+
     m_world.subscribe< event::projectile_collision >( *this );
     m_world.subscribe< event::entity_respawned >( *this );
     m_world.subscribe< event::powerup_taken >( *this );
@@ -1204,39 +1390,63 @@ void animation_system::on_event( const event::powerup_taken& event )
     {
         ecs::entity& taker = *event.get_performer();
 
-        powerup_animations& powerup_anim = taker.get_component< powerup_animations >();
+        const powerup_animations& powerup_anim = taker.get_component< powerup_animations >();
         if( !powerup_anim.has_animation( type ) )
         {
             const component::geometry& g = taker.get_component< component::geometry >();
             QRect rect = g.get_rect();
             mult_rect_size( rect, 2 );
 
-            ecs::entity& animation_entity =
-                    create_animation_entity( rect, animation_type::shield );
+            ecs::entity_id taker_id{ taker.get_id() };
+            create_animation_entity( rect, animation_type::shield, [ this, type, taker_id ]( ecs::entity& animation_entity )
+            {
+                if( !m_world.entity_present( taker_id ) )
+                {
+                    return false;
+                }
+
+                // another shield might have been taken at the same tick
+                powerup_animations& animations = m_world.get_entity( taker_id ).get_component_mut< powerup_animations >();
+                if( animations.has_animation( type ) )
+                {
+                    return false;
+                }
 
-            powerup_anim.add_animation( type, animation_entity );
+                animations.add_animation( type, animation_entity );
+                return true;
+            } );
         }
     }
 }
 
-ecs::entity& animation_system::create_animation_entity( const QRect& rect, const animation_type& type )
+void animation_system::create_animation_entity( const QRect& rect,
+                                                const animation_type& type,
+                                                attach_func attach )
 {
     const animation_data& data = m_animation_data.at( type );
-    ecs::entity& e = create_animation( rect, data, type, m_world );
 
-    event::animation_started event_animation{ type };
-    event_animation.set_cause_entity( e );
-
-    animation_start_info info{ &e, clock::now() };
-    m_animations.emplace_back( info );
+    // structural changes are deferred until the next sync point of the world
+    m_world.get_command_buffer().create_entity( [ rect, data, type ]( ecs::world& world ) -> ecs::entity&
+    {
+        return create_animation( rect, data, type, world );
+    },
+    [ this, type, attach ]( ecs::entity& e )
+    {
+        if( attach && !attach( e ) )
+        {
+            m_world.remove_entity( e );
+            return;
+        }
 
-    m_world.emit_event( event_animation );
+        animation_start_info info{ &e, clock::now() };
+        m_animations.emplace_back( info );
 
-    return e;
+        event::animation_started event_animation{ type };
+        event_animation.set_cause_entity( e );
+        m_world.emit_event( event_animation );
+    } );
 }
 
 }// system
 
 }// game
-
-
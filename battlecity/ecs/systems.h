@@ -2,10 +2,14 @@
 #define SYSTEMS_H
 
 #include <map>
+#include <random>
+#include <functional>
 #include <vector>
+#include <unordered_map>
 
 #include "events.h"
 #include "components.h"
+#include "spatial_grid.h"
 #include "framework/world.h"
 
 namespace game
@@ -14,23 +18,40 @@ namespace game
 namespace system
 {
 
-class movement_system final : public ecs::system
+class movement_system final : public ecs::system,
+                              public ecs::event_callback< event::move_direction_requested >
 {
 public:
     explicit movement_system( ecs::world& world );
+    ~movement_system();
 
     void init() override;
     bool tick() override;
     void clean() override;
 
+    void on_event( const event::move_direction_requested& event ) override;
+
 private:
     std::pair< bool, ecs::entity* > validate_movement( ecs::entity &curr_entity,
-                                                       component::movement& move,
                                                        const QRect& new_position,
-                                                       component::positioning& pos );
+                                                       const component::positioning& pos );
+
+    // Projectiles only check the predicted impact tile and the objects in the corridor swept by the step
+    std::pair< bool, ecs::entity* > validate_projectile_movement( ecs::entity& curr_entity,
+                                                                  const QRect& old_position,
+                                                                  const QRect& new_position );
+
+    ecs::entity* find_obstacle( const QRect& area,
+                                const ecs::entity& curr_entity,
+                                ecs::entity_id ignored_id = INVALID_NUMERIC_ID );
 
 private:
-    component::geometry* m_map_geom{ nullptr };
+    QRect m_map_rect;
+    spatial_grid* m_grid{ nullptr };
+
+    // keep the grid up to date as the objects come and go
+    ecs::observer_id m_geometry_added_observer{ 0 };
+    ecs::observer_id m_geometry_removed_observer{ 0 };
 };
 
 //
@@ -64,14 +85,17 @@ private:
 
     void handle_existing_projectiles();
     void create_new_projectiles();
+    void create_projectile( ecs::entity& shooter, const QRect& rect, const movement_direction& direction );
 
 private:
     QSize m_projectile_size{};
     uint32_t m_damage{ 0 };
     uint32_t m_speed{ 0 };
 
-    component::geometry* m_map_geom{ nullptr };
     std::list< event::projectile_collision > m_collisions;
+
+    // predicts the impact again as the walls get destroyed
+    ecs::observer_id m_tile_cleared_observer{ 0 };
 };
 
 //
@@ -107,9 +131,21 @@ private:
 
     std::vector< const ecs::entity* > get_free_respawns();
 
+    // Moves the object to the cells of pos in the objects layer of the graph, removes it if pos is null
+    void set_object_cells( ecs::entity_id id, const component::positioning* pos );
+
 private:
     std::list< death_info > m_death_info;
-    std::vector< const ecs::entity* > m_empty_tiles;
+    std::vector< size_t > m_free_cells; // reused by get_free_respawns()
+
+    // the objects layer is updated for the objects moved since the last respawn check only
+    map_graph* m_graph{ nullptr };
+    std::unordered_map< ecs::entity_id, std::vector< size_t > > m_object_cells;
+    std::vector< uint32_t > m_cell_objects; // number of objects in every cell
+    uint64_t m_synced_tick{ 0 };
+
+    ecs::observer_id m_object_added_observer{ 0 };
+    ecs::observer_id m_object_removed_observer{ 0 };
 };
 
 //
@@ -164,16 +200,20 @@ public:
                              ecs::world& world ) noexcept;
     void init();
     bool tick() override;
-    void clean() override;
 
 private:
-    bool maybe_fire();
-    bool maybe_change_direction();
-    bool make_decision( float chance ) const;
+    // tanks are processed in parallel, so each worker has its own generator
+    struct worker_state
+    {
+        std::mt19937 rng{ std::random_device{}() };
+    };
+
+    bool maybe_fire( std::mt19937& rng ) const;
+    bool maybe_change_direction( std::mt19937& rng ) const;
+    bool make_decision( float chance, std::mt19937& rng ) const;
 
 private:
-    ecs::entity* m_player{ nullptr };
-    std::list< ecs::entity* > m_enemies;
+    std::vector< worker_state > m_worker_states;
     float m_chance_to_fire{ 0.0 };
     float m_chance_to_change_direction{ 0.0 };
 };
@@ -208,7 +248,13 @@ public:
     void on_event( const event::powerup_taken& );
 
 private:
-    ecs::entity& create_animation_entity( const QRect& rect, const animation_type& type );
+    // Called once the animation entity is created, returns false if it isn't needed anymore
+    using attach_func = std::function< bool( ecs::entity& ) >;
+
+    // The entity is created at the next sync point
+    void create_animation_entity( const QRect& rect,
+                                  const animation_type& type,
+                                  attach_func attach = attach_func{} );
 
 private:
     std::list< animation_start_info > m_animations;
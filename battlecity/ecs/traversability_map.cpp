@@ -0,0 +1,263 @@
+#include "traversability_map.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static constexpr int word_bits{ 64 };
+
+// bits from lo to hi( inclusive )
+static inline uint64_t range_mask( int lo, int hi ) noexcept
+{
+    return ( ~uint64_t{ 0 } >> ( word_bits - 1 - hi ) ) & ( ~uint64_t{ 0 } << lo );
+}
+
+static inline int lowest_bit( uint64_t word ) noexcept
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_ctzll( word );
+#else
+    int bit{ 0 };
+    while( !( word & 1 ) )
+    {
+        word >>= 1;
+        ++bit;
+    }
+
+    return bit;
+#endif
+}
+
+static inline int highest_bit( uint64_t word ) noexcept
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return word_bits - 1 - __builtin_clzll( word );
+#else
+    int bit{ word_bits - 1 };
+    while( !( word & ( uint64_t{ 1 } << bit ) ) )
+    {
+        --bit;
+    }
+
+    return bit;
+#endif
+}
+
+static inline int count_bits( uint64_t word ) noexcept
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_popcountll( word );
+#else
+    int count{ 0 };
+    for( ; word; word &= word - 1 )
+    {
+        ++count;
+    }
+
+    return count;
+#endif
+}
+
+namespace game
+{
+
+void traversability_map::resize( int rows, int columns )
+{
+    if( rows < 0 || columns < 0 )
+    {
+        throw std::invalid_argument{ "Map size can't be negative" };
+    }
+
+    m_rows = rows;
+    m_columns = columns;
+    m_words_per_row = static_cast< size_t >( ( columns + word_bits - 1 ) / word_bits );
+
+    m_tiles.assign( m_words_per_row * static_cast< size_t >( rows ), 0 );
+    m_objects.assign( m_words_per_row * static_cast< size_t >( rows ), 0 );
+}
+
+void traversability_map::clear( const cell_layer& layer ) noexcept
+{
+    std::vector< uint64_t >& words = get_layer( layer );
+    std::fill( words.begin(), words.end(), 0 );
+}
+
+void traversability_map::set_blocked( const cell_layer& layer, int row, int col, bool blocked ) noexcept
+{
+    if( !contains( row, col ) )
+    {
+        return;
+    }
+
+    uint64_t& word = get_layer( layer )[ row * m_words_per_row + col / word_bits ];
+    uint64_t bit{ uint64_t{ 1 } << ( col % word_bits ) };
+
+    word = blocked? word | bit : word & ~bit;
+}
+
+bool traversability_map::is_blocked( const cell_layer& layer, int row, int col ) const noexcept
+{
+    return contains( row, col ) &&
+           ( get_layer( layer )[ row * m_words_per_row + col / word_bits ] >> ( col % word_bits ) ) & 1;
+}
+
+bool traversability_map::is_free( const cell_layer& layer,
+                                  int first_row,
+                                  int first_col,
+                                  int last_row,
+                                  int last_col ) const noexcept
+{
+    first_row = std::max( first_row, 0 );
+    first_col = std::max( first_col, 0 );
+    last_row = std::min( last_row, m_rows - 1 );
+    last_col = std::min( last_col, m_columns - 1 );
+
+    if( first_row > last_row || first_col > last_col )
+    {
+        return true;
+    }
+
+    const std::vector< uint64_t >& words = get_layer( layer );
+    int first_word{ first_col / word_bits };
+    int last_word{ last_col / word_bits };
+
+    for( int row{ first_row }; row <= last_row; ++row )
+    {
+        const uint64_t* row_words{ &words[ row * m_words_per_row ] };
+
+        for( int w{ first_word }; w <= last_word; ++w )
+        {
+            int lo{ w == first_word? first_col % word_bits : 0 };
+            int hi{ w == last_word? last_col % word_bits : word_bits - 1 };
+
+            if( row_words[ w ] & range_mask( lo, hi ) )
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int traversability_map::find_blocked_in_row( const cell_layer& layer,
+                                             int row,
+                                             int from_col,
+                                             bool forward ) const noexcept
+{
+    if( !contains( row, from_col ) )
+    {
+        return -1;
+    }
+
+    const uint64_t* row_words{ &get_layer( layer )[ row * m_words_per_row ] };
+    int w{ from_col / word_bits };
+
+    if( forward )
+    {
+        uint64_t word{ row_words[ w ] & range_mask( from_col % word_bits, word_bits - 1 ) };
+        while( !word && ++w < static_cast< int >( m_words_per_row ) )
+        {
+            word = row_words[ w ];
+        }
+
+        return word? w * word_bits + lowest_bit( word ) : -1;
+    }
+
+    uint64_t word{ row_words[ w ] & range_mask( 0, from_col % word_bits ) };
+    while( !word && --w >= 0 )
+    {
+        word = row_words[ w ];
+    }
+
+    return word? w * word_bits + highest_bit( word ) : -1;
+}
+
+int traversability_map::find_blocked_in_column( const cell_layer& layer,
+                                                int col,
+                                                int from_row,
+                                                bool forward ) const noexcept
+{
+    if( !contains( from_row, col ) )
+    {
+        return -1;
+    }
+
+    const std::vector< uint64_t >& words = get_layer( layer );
+    size_t w{ static_cast< size_t >( col / word_bits ) };
+    int bit{ col % word_bits };
+    int step{ forward? 1 : -1 };
+
+    for( int row{ from_row }; row >= 0 && row < m_rows; row += step )
+    {
+        if( ( words[ row * m_words_per_row + w ] >> bit ) & 1 )
+        {
+            return row;
+        }
+    }
+
+    return -1;
+}
+
+void traversability_map::get_free_cells( std::vector< size_t >& cells ) const
+{
+    cells.clear();
+
+    for( int row{ 0 }; row < m_rows; ++row )
+    {
+        for( size_t w{ 0 }; w < m_words_per_row; ++w )
+        {
+            size_t index{ row * m_words_per_row + w };
+            uint64_t free{ ~( m_tiles[ index ] | m_objects[ index ] ) & get_valid_mask( w ) };
+
+            for( ; free; free &= free - 1 )
+            {
+                cells.emplace_back( static_cast< size_t >( row * m_columns ) + w * word_bits + lowest_bit( free ) );
+            }
+        }
+    }
+}
+
+size_t traversability_map::count_free_cells() const noexcept
+{
+    size_t count{ 0 };
+
+    for( size_t index{ 0 }; index < m_tiles.size(); ++index )
+    {
+        count += count_bits( ~( m_tiles[ index ] | m_objects[ index ] ) & get_valid_mask( index % m_words_per_row ) );
+    }
+
+    return count;
+}
+
+int traversability_map::get_rows_count() const noexcept
+{
+    return m_rows;
+}
+
+int traversability_map::get_columns_count() const noexcept
+{
+    return m_columns;
+}
+
+std::vector< uint64_t >& traversability_map::get_layer( const cell_layer& layer ) noexcept
+{
+    return layer == cell_layer::tiles? m_tiles : m_objects;
+}
+
+const std::vector< uint64_t >& traversability_map::get_layer( const cell_layer& layer ) const noexcept
+{
+    return layer == cell_layer::tiles? m_tiles : m_objects;
+}
+
+bool traversability_map::contains( int row, int col ) const noexcept
+{
+    return row >= 0 && row < m_rows && col >= 0 && col < m_columns;
+}
+
+uint64_t traversability_map::get_valid_mask( size_t w ) const noexcept
+{
+    int cells_in_word{ std::min( word_bits, m_columns - static_cast< int >( w ) * word_bits ) };
+    return range_mask( 0, cells_in_word - 1 );
+}
+
+}// game
@@ -0,0 +1,60 @@
+#ifndef TRAVERSABILITY_MAP_H
+#define TRAVERSABILITY_MAP_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace game
+{
+
+enum class cell_layer{ tiles, objects };
+
+// One bit per map cell and per layer, set if the cell is blocked by a tile or an object.
+// Rows are padded to whole 64 bit words, so that the queries test up to 64 cells of a row at once
+class traversability_map final
+{
+public:
+    void resize( int rows, int columns );
+    void clear( const cell_layer& layer ) noexcept;
+
+    void set_blocked( const cell_layer& layer, int row, int col, bool blocked ) noexcept;
+    bool is_blocked( const cell_layer& layer, int row, int col ) const noexcept;
+
+    // True if none of the cells between the rows and columns( inclusive ) is blocked in the layer
+    bool is_free( const cell_layer& layer, int first_row, int first_col, int last_row, int last_col ) const noexcept;
+
+    // First blocked cell of the row / column starting from the given one( inclusive ) and going
+    // towards the higher or the lower indices. Return -1 if there's no such cell
+    int find_blocked_in_row( const cell_layer& layer, int row, int from_col, bool forward ) const noexcept;
+    int find_blocked_in_column( const cell_layer& layer, int col, int from_row, bool forward ) const noexcept;
+
+    // Replaces the contents of cells with the indices( row * columns + col ) of the cells
+    // free in both layers, in the ascending order
+    void get_free_cells( std::vector< size_t >& cells ) const;
+    size_t count_free_cells() const noexcept;
+
+    int get_rows_count() const noexcept;
+    int get_columns_count() const noexcept;
+
+private:
+    std::vector< uint64_t >& get_layer( const cell_layer& layer ) noexcept;
+    const std::vector< uint64_t >& get_layer( const cell_layer& layer ) const noexcept;
+
+    bool contains( int row, int col ) const noexcept;
+
+    // bits of the word w of a row which stand for the cells of the map
+    uint64_t get_valid_mask( size_t w ) const noexcept;
+
+private:
+    int m_rows{ 0 };
+    int m_columns{ 0 };
+    size_t m_words_per_row{ 0 };
+
+    std::vector< uint64_t > m_tiles;
+    std::vector< uint64_t > m_objects;
+};
+
+}// game
+
+#endif
@@ -6,6 +6,8 @@
 #include "ecs/framework/world.h"
 #include "ecs/entity_factory.h"
 #include "ecs/components.h"
+#include "ecs/resources.h"
+#include "ecs/spatial_grid.h"
 #include "game_settings.h"
 
 static constexpr auto tile_char_empty = 'e';
@@ -107,12 +109,12 @@ add_player_base( bool& player_base_found, int row, int col, const game_settings&
     return create_entity_player_base( base_rect, settings.get_player_base_health(), world );
 }
 
-ecs::entity&
-add_tank( int row, int col, const alignment& align, const game_settings& settings, ecs::world& world )
+tank_entity_params
+tank_params( int row, int col, const alignment& align, const game_settings& settings )
 {
     QRect tank_rect{ obj_rect( row, col, settings.get_tile_size(), settings.get_tank_size() ) };
 
-    tank_entity_params params
+    return tank_entity_params
     {
         tank_rect,
         settings.get_tank_speed(),
@@ -122,16 +124,12 @@ add_tank( int row, int col, const alignment& align, const game_settings& setting
         std::chrono::milliseconds{ settings.get_respawn_delay_ms() },
         align
     };
+}
 
-    ecs::entity& e = create_entity_tank( params, world );
-
-    if( align == alignment::enemy )
-    {
-        e.get_component< component::graphics >().set_visible( false );
-        e.get_component< component::health >().decrease( settings.get_tank_health() );
-    }
-
-    return e;
+ecs::entity&
+add_tank( int row, int col, const alignment& align, const game_settings& settings, ecs::world& world )
+{
+    return create_entity_tank( tank_params( row, col, align, settings ), world );
 }
 
 uint32_t get_tile_health( const tile_type& type, const game_settings& settings )
@@ -172,13 +170,18 @@ void create_enemies( const game_settings& settings,
                      ecs::world& world,
                      map_interface* mediator )
 {
-    for( uint32_t enemy{ 0 }; enemy < settings.get_enemies_number(); ++enemy )
+    std::vector< ecs::entity* > enemies{
+        create_enemy_tanks( tank_params( 0, 0, alignment::enemy, settings ), settings.get_enemies_number(), world ) };
+
+    // enemies wait for the respawn
+    for( ecs::entity* entity : enemies )
     {
-        ecs::entity& entity = add_tank( 0, 0, alignment::enemy, settings, world );
-        entity.add_component< component::positioning >();
+        entity->get_component_mut< component::graphics >().set_visible( false );
+        entity->get_component_mut< component::health >().decrease( settings.get_tank_health() );
+
         if( mediator )
         {
-            mediator->add_object( object_type::enemy_tank, &entity, false );
+            mediator->add_object( object_type::enemy_tank, entity, false );
         }
     }
 }
@@ -240,6 +243,10 @@ void read_map_file( map_data& data,
     map_graph& graph = data.get_map_graph();
     graph.clear();
 
+    // the graph is laid out at once when the size is known, so the tiles get their nodes afterwards
+    std::vector< ecs::entity* > tiles;
+    std::vector< std::pair< size_t, ecs::entity* > > objects_on_tiles;
+
     while( !text_stream.atEnd() )
     {
         text_stream >> tile_char;
@@ -250,9 +257,7 @@ void read_map_file( map_data& data,
             const tile_type& type{ tile_info.first };
 
             ecs::entity& tile_entity = add_tile( type, rows_count, curr_column, settings, world );
-
-            map_tile_node& node =
-                    create_map_node( tile_entity, rows_count, curr_column, columns_count, graph );
+            tiles.emplace_back( &tile_entity );
 
             ecs::entity* entity{ nullptr };
             if( tile_info.second == object_type::player_base )
@@ -270,10 +275,9 @@ void read_map_file( map_data& data,
                 entity = &add_tank( rows_count, curr_column, alignment::player, settings, world );
             }
 
-            tile_entity.add_component< component::positioning >( node );
             if( entity )
             {
-                entity->add_component< component::positioning >( node );
+                objects_on_tiles.emplace_back( tiles.size() - 1, entity );
             }
 
             if( mediator )
@@ -316,14 +320,33 @@ void read_map_file( map_data& data,
     QSize map_size{ columns_count, rows_count };
     data.set_map_size( map_size );
 
-    // add map entity
+    // the last row may lack the line break
     const QSize& tile_size{ settings.get_tile_size() };
+    int graph_columns{ columns_count? columns_count : curr_column };
+    int graph_rows{ graph_columns? static_cast< int >( tiles.size() ) / graph_columns : 0 };
+    graph.assign( graph_rows, graph_columns, tile_size, tiles );
+    world.set_resource< resource::tile_graph >( graph, world );
+
+    for( size_t i{ 0 }; i < tiles.size(); ++i )
+    {
+        tiles[ i ]->add_component< component::positioning >( graph[ i ] );
+    }
+
+    for( const auto& object : objects_on_tiles )
+    {
+        object.second->add_component< component::positioning >( graph[ object.first ] );
+    }
+
+    // add map entity
     QRect map_rect{ 0, 0, tile_size.width() * map_size.width(), tile_size.height() * map_size.height() };
     create_map_entity( map_rect, world );
 
     create_enemies( settings, world, mediator );
     create_frags( settings, world, mediator );
     create_powerups( settings, world, mediator );
+
+    // index all the objects at once, from now on movement_system maintains the grid
+    world.set_resource< spatial_grid >( map_rect, tile_size ).rebuild( world );
 }
 
 }// game
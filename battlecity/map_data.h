@@ -34,6 +34,7 @@ public slots:
     virtual void entity_hit( const event::entity_hit& ) = 0;
     virtual void entity_killed( const event::entity_killed& ) = 0;
     virtual void entities_removed( const event::entities_removed& ) = 0;
+    virtual void hud_changed() = 0;
 
     virtual void prepare_to_load_next_level() = 0;
     virtual void level_started( const QString& level ) = 0;
@@ -122,28 +122,26 @@ void qml_map_interface::prepare_to_load_next_level()
     emit load_next_level();
 }
 
-void qml_map_interface::entity_hit( const event::entity_hit& event )
+void qml_map_interface::entity_hit( const event::entity_hit& )
 {
-    const object_type& victim_type = event.get_subject_type();
-    if( victim_type ==  object_type::player_base )
-    {
-        emit base_remaining_health_changed( m_controller.get_base_remaining_health() );
-    }
+    // the base health is updated by hud_changed() once the tick is over
 }
 
 void qml_map_interface::entity_killed( const event::entity_killed& event )
 {
     const object_type& victim_type = event.get_subject_type();
-    if( victim_type ==  object_type::player_tank )
-    {
-        emit player_remaining_lifes_changed( m_controller.get_player_remaining_lifes() );
-    }
-    else if( victim_type == object_type::enemy_tank )
+    if( victim_type == object_type::enemy_tank )
     {
         objects_of_type_changed( object_type::frag );
     }
 }
 
+void qml_map_interface::hud_changed()
+{
+    emit player_remaining_lifes_changed( get_player_remaining_lifes() );
+    emit base_remaining_health_changed( get_base_remaining_health() );
+}
+
 void qml_map_interface::entities_removed( const event::entities_removed& event )
 {
     std::unordered_map< object_type,
@@ -30,6 +30,7 @@ public slots:
     void entity_hit( const event::entity_hit& ) override;
     void entity_killed( const event::entity_killed& ) override;
     void entities_removed( const event::entities_removed& ) override;
+    void hud_changed() override;
 
     void level_started( const QString& level ) override;
     void level_completed( const level_game_result& result ) override;
@@ -19,13 +19,13 @@ base_map_object::base_map_object( ecs::entity* entity, const object_type& type,
     }
 
     ecs::world& world = m_entity->get_world();
-    world.subscribe< event::geometry_changed >( *this );
+    world.subscribe_for< event::geometry_changed >( m_entity->get_id(), *this );
 }
 
 base_map_object::~base_map_object()
 {
     ecs::world& world = m_entity->get_world();
-    world.unsubscribe< event::geometry_changed >( *this );
+    world.unsubscribe_for< event::geometry_changed >( m_entity->get_id(), *this );
     m_entity->get_world().schedule_remove_entity( *m_entity );
 }
 
@@ -47,41 +47,41 @@ const object_type& base_map_object::get_type() const noexcept
 int base_map_object::get_position_x() const noexcept
 {
     component::geometry& g = m_entity->get_component_unsafe< component::geometry >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::geometry > l{ g, ecs::lock_mode::read };
     return g.get_pos().x();
 }
 
 int base_map_object::get_position_y() const noexcept
 {
     component::geometry& g = m_entity->get_component_unsafe< component::geometry >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::geometry > l{ g, ecs::lock_mode::read };
     return g.get_pos().y();
 }
 
 int base_map_object::get_width() const noexcept
 {
     component::geometry& g = m_entity->get_component_unsafe< component::geometry >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::geometry > l{ g, ecs::lock_mode::read };
     return g.get_size().width();
 }
 
 int base_map_object::get_height() const noexcept
 {
     component::geometry& g = m_entity->get_component_unsafe< component::geometry >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::geometry > l{ g, ecs::lock_mode::read };
     return g.get_size().height();
 }
 
 int base_map_object::get_rotation() const noexcept
 {
     component::geometry& g = m_entity->get_component_unsafe< component::geometry >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::geometry > l{ g, ecs::lock_mode::read };
     return g.get_rotation();
 }
 
 bool base_map_object::get_traversible() const noexcept
 {
-    ecs::rw_lock_guard< ecs::rw_lock > l{ *m_entity, ecs::lock_mode::read };
+    ecs::lock_guard_for< ecs::entity > l{ *m_entity, ecs::lock_mode::read };
     return !( m_entity->has_component< component::non_traversible_tile >() ||
               m_entity->has_component< component::non_traversible_object >() );
 }
@@ -95,7 +95,7 @@ void base_map_object::on_event( const event::geometry_changed& event )
 
         {
             component::geometry& g = m_entity->get_component_unsafe< component::geometry >();
-            ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+            ecs::lock_guard_for< component::geometry > l{ g, ecs::lock_mode::read };
             pos = g.get_pos();
             rotation = g.get_rotation();
         }
@@ -12,26 +12,26 @@ graphics_map_object::graphics_map_object( ecs::entity* entity, const object_type
     base_map_object( entity, type, parent )
 {
     ecs::world& world = m_entity->get_world();
-    world.subscribe< event::graphics_changed >( *this );
+    world.subscribe_for< event::graphics_changed >( m_entity->get_id(), *this );
 }
 
 graphics_map_object::~graphics_map_object()
 {
     ecs::world& world = m_entity->get_world();
-    world.unsubscribe< event::graphics_changed >( *this );
+    world.unsubscribe_for< event::graphics_changed >( m_entity->get_id(), *this );
 }
 
 const QString& graphics_map_object::get_image_path() const noexcept
 {
     component::graphics& g = m_entity->get_component_unsafe< component::graphics >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::graphics > l{ g, ecs::lock_mode::read };
     return g.get_image_path();
 }
 
 bool graphics_map_object::get_visible() const noexcept
 {
     component::graphics& g = m_entity->get_component_unsafe< component::graphics >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::graphics > l{ g, ecs::lock_mode::read };
     return g.get_visible();
 }
 
@@ -40,7 +40,7 @@ void graphics_map_object::on_event( const event::graphics_changed& event )
     if( event.get_cause_entity() == m_entity )
     {
         component::graphics& g = m_entity->get_component_unsafe< component::graphics >();
-        ecs::rw_lock_guard< ecs::rw_lock > l{ g, ecs::lock_mode::read };
+        ecs::lock_guard_for< component::graphics > l{ g, ecs::lock_mode::read };
 
         if( event.visibility_changed() )
         {
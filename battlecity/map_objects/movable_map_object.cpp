@@ -67,15 +67,16 @@ movable_map_object::movable_map_object( ecs::entity* entity,
 
 void movable_map_object::set_move_direction( const QString& direction )
 {
-    component::movement& m = m_entity->get_component_unsafe< component::movement >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ m, ecs::lock_mode::read };
-    m.set_move_direction( str_to_move_direction( direction ) );
+    // applied by the movement system at the beginning of the next tick,
+    // the queue only overflows if the game thread stalls, so the input is dropped then
+    event::move_direction_requested request{ m_entity->get_id(), str_to_move_direction( direction ) };
+    m_entity->get_world().post_input( request );
 }
 
 QString movable_map_object::get_move_direction() const
 {
     component::movement& m = m_entity->get_component_unsafe< component::movement >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ m, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::movement > l{ m, ecs::lock_mode::read };
     return move_direction_to_str( m.get_move_direction() );
 }
 
@@ -20,14 +20,14 @@ tank_map_object::tank_map_object( ecs::entity* entity, const object_type& type,
 bool tank_map_object::set_fired( bool fired ) noexcept
 {
     component::turret_object& t = m_entity->get_component_unsafe< component::turret_object >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ t, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::turret_object > l{ t, ecs::lock_mode::read };
     return t.set_fire_status( fired );
 }
 
 bool tank_map_object::get_fired() const noexcept
 {
     component::turret_object& t = m_entity->get_component_unsafe< component::turret_object >();
-    ecs::rw_lock_guard< ecs::rw_lock > l{ t, ecs::lock_mode::read };
+    ecs::lock_guard_for< component::turret_object > l{ t, ecs::lock_mode::read };
     return t.has_fired();
 }
 
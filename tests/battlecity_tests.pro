@@ -6,22 +6,45 @@ CONFIG -= app_bundle
 
 TEMPLATE = app
 
+# the game sources include the ecs headers relative to the project root
+INCLUDEPATH += ../battlecity
+
 HEADERS +=../battlecity/ecs/framework/entity.h \
+        ../battlecity/ecs/framework/archetype.h \
+        ../battlecity/ecs/framework/view.h \
+        ../battlecity/ecs/framework/prefab.h \
+        ../battlecity/ecs/framework/command_buffer.h \
         ../battlecity/ecs/framework/id_engine.h \
         ../battlecity/ecs/framework/world.h \
         ../battlecity/ecs/framework/details/polymorph.h \
+        ../battlecity/ecs/framework/details/lock_policy.h \
         ../battlecity/ecs/framework/details/rw_lock.h \
         ../battlecity/ecs/framework/details/atomic_locks.h \
+        ../battlecity/ecs/framework/details/mpsc_ring.h \
+        ../battlecity/ecs/framework/details/block_pool.h \
+        ../battlecity/ecs/framework/details/thread_pool.h \
         ../battlecity/ecs/framework/details/rw_lock_guard.h \
         ../battlecity/ecs/framework/details/rw_lock_modes.h \
         ../battlecity/ecs/framework/details/cpp14/make_unique.h \
-        ../battlecity/ecs/framework/details/cpp14/integer_sequence.h
+        ../battlecity/ecs/framework/details/cpp14/integer_sequence.h \
+        ../battlecity/ecs/traversability_map.h \
+        ../battlecity/ecs/map_graph.h \
+        ../battlecity/ecs/components.h \
+        ../battlecity/ecs/spatial_grid.h
 
 SOURCES +=  tst_ecs_tests.cpp \
         ../battlecity/ecs/framework/entity.cpp \
+        ../battlecity/ecs/framework/archetype.cpp \
+        ../battlecity/ecs/framework/view.cpp \
+        ../battlecity/ecs/framework/command_buffer.cpp \
         ../battlecity/ecs/framework/id_engine.cpp \
         ../battlecity/ecs/framework/world.cpp \
         ../battlecity/ecs/framework/details/polymorph.cpp \
         ../battlecity/ecs/framework/details/polymorph.impl \
         ../battlecity/ecs/framework/details/rw_lock.cpp \
-        ../battlecity/ecs/framework/details/atomic_locks.cpp
+        ../battlecity/ecs/framework/details/atomic_locks.cpp \
+        ../battlecity/ecs/framework/details/thread_pool.cpp \
+        ../battlecity/ecs/traversability_map.cpp \
+        ../battlecity/ecs/map_graph.cpp \
+        ../battlecity/ecs/components.cpp \
+        ../battlecity/ecs/spatial_grid.cpp
@@ -1,6 +1,17 @@
 #include <QtTest>
 
+#include <thread>
+#include <typeindex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "../battlecity/ecs/framework/world.h"
+#include "../battlecity/ecs/traversability_map.h"
+#include "../battlecity/ecs/spatial_grid.h"
+#include "../battlecity/ecs/components.h"
+
+static constexpr int lookups_num{ 100000 };
 
 class component_1{};
 
@@ -18,6 +29,13 @@ struct test_event
     int data{ 0 };
 };
 
+struct entity_event
+{
+    entity_event( ecs::entity& e ) noexcept : cause( &e ){}
+    ecs::entity* get_cause_entity() const noexcept{ return cause; }
+    ecs::entity* cause{ nullptr };
+};
+
 class test_system : public ecs::system,
                     public ecs::event_callback< test_event >
 {
@@ -35,6 +53,28 @@ public:
     static constexpr int data_upon_init{ 1 };
 };
 
+// System with the access declarations made by the test
+class scheduled_system : public ecs::system
+{
+public:
+    scheduled_system( ecs::world& world, std::function< bool() > on_tick ) :
+        ecs::system( world ), m_on_tick( std::move( on_tick ) ){}
+
+    template< typename... components >
+    scheduled_system& with_reads(){ reads< components... >(); return *this; }
+
+    template< typename... components >
+    scheduled_system& with_writes(){ writes< components... >(); return *this; }
+
+    template< typename... events >
+    scheduled_system& with_emits(){ emits< events... >(); return *this; }
+
+    bool tick() override{ return m_on_tick(); }
+
+private:
+    std::function< bool() > m_on_tick;
+};
+
 class ecs_tests : public QObject
 {
     Q_OBJECT
@@ -42,6 +82,41 @@ class ecs_tests : public QObject
 private slots:
     void entity_tests();
     void world_tests();
+    void archetype_tests();
+    void view_tests();
+    void pool_tests();
+    void prefab_tests();
+    void bulk_tests();
+    void polymorph_tests();
+    void par_for_each_tests();
+    void scheduler_tests();
+    void command_buffer_tests();
+    void queued_events_tests();
+    void entity_events_tests();
+    void input_tests();
+    void lock_policy_tests();
+    void change_tracking_tests();
+    void observer_tests();
+    void resource_tests();
+    void traversability_tests();
+    void spatial_grid_tests();
+
+    // lookup cost of the dense type ids compared to the std::type_index based hashing
+    void type_index_lookup_benchmark();
+    void dense_id_lookup_benchmark();
+    void entity_lookup_benchmark();
+
+    // one shot prefab instantiation compared to adding the components one by one
+    void add_components_benchmark();
+    void instantiate_benchmark();
+
+    // rw_spinlock compared to rw_lock and to the entity lock of the build( ECS_LOCK_ATOMIC / ECS_LOCK_MUTEX )
+    void rw_lock_contention_benchmark_data();
+    void rw_lock_contention_benchmark();
+
+    // a loop of a system ticked along with another one, sequential compared to par_for_each_with()
+    void grouped_loop_benchmark_data();
+    void grouped_loop_benchmark();
 
 private:
     void add_components( ecs::entity& e );
@@ -136,6 +211,26 @@ void ecs_tests::entity_tests()
         QVERIFY( e.get_component< component_2 >().data == value );
     }
 
+    // Check the components keep their addresses when a component of a new type is added
+    {
+        struct late_component{ int data[ 16 ]; }; // gets the highest type id when first used
+
+        component_2& comp_2 = e.get_component< component_2 >();
+        e.add_component< late_component >();
+        QVERIFY( &comp_2 == &e.get_component< component_2 >() );
+
+        bool same_address{ false };
+        world.for_each_with< component_2 >( [&]( ecs::entity& owner, component_2& c )
+        {
+            same_address |= owner == e && &c == &comp_2;
+            return true;
+        } );
+
+        QVERIFY( same_address );
+
+        e.remove_component< late_component >();
+    }
+
     // Check remove_component
     {
         e.remove_component< component_1 >();
@@ -268,6 +363,27 @@ void ecs_tests::world_tests()
     world.remove_entity( entity_two_comps.get_id() );
     QVERIFY( !world.entity_present( entity_two_comps.get_id() ) );
 
+    // check that the ids of removed entities stay invalid after their slots are reused
+    {
+        ecs::entity& e = world.create_entity();
+        ecs::entity_id stale_id{ e.get_id() };
+        world.remove_entity( e );
+
+        ecs::entity& reused = world.create_entity();
+        QVERIFY( ecs::get_entity_index( reused.get_id() ) == ecs::get_entity_index( stale_id ) );
+        QVERIFY( reused.get_id() != stale_id );
+        QVERIFY( !world.entity_present( stale_id ) );
+        QVERIFY_EXCEPTION_THROWN( world.get_entity( stale_id ), std::out_of_range );
+        world.remove_entity( reused );
+
+        // versions take the whole high half of the id, so a slot is reused for ages before they wrap
+        ecs::entity_id old_id{ ecs::make_entity_id( 7, 0xFFFFFFFEu ) };
+        QVERIFY( ecs::get_entity_index( old_id ) == 7 );
+        QVERIFY( ecs::get_entity_version( old_id ) == 0xFFFFFFFEu );
+        QVERIFY( ecs::next_entity_version( 4095 ) == 4096 );
+        QVERIFY( ecs::next_entity_version( 0xFFFFFFFFu ) == 1 );
+    }
+
     // check systems handling
     test_system system1{ world };
     test_system system2{ world };
@@ -324,6 +440,1673 @@ void ecs_tests::world_tests()
     QVERIFY( system2.data == test_system::data_upon_init + 1 );
 }
 
+void ecs_tests::archetype_tests()
+{
+    ecs::world world;
+    ecs::entity& e1 = world.create_entity();
+    ecs::entity& e2 = world.create_entity();
+    ecs::entity& e3 = world.create_entity();
+    add_components( e1 );
+    add_components( e2 );
+    e3.add_component< component_2 >( m_component2_data );
+
+    // check chunks
+    {
+        size_t chunks{ 0 };
+        size_t entities{ 0 };
+        bool columns_valid{ true };
+        world.for_each_chunk< component_2 >( [ & ]( const ecs::archetype_chunk< component_2 >& chunk )
+        {
+            ++chunks;
+            entities += chunk.size();
+
+            ecs::component_span< component_2 > column = chunk.get_column< component_2 >();
+            for( size_t i{ 0 }; i < column.size(); ++i )
+            {
+                columns_valid = columns_valid &&
+                        &column[ i ] == &chunk.get_entity( i ).get_component< component_2 >();
+            }
+
+            return true;
+        } );
+
+        QVERIFY( chunks == 2 );
+        QVERIFY( entities == 3 );
+        QVERIFY( columns_valid );
+
+        chunks = 0;
+        entities = 0;
+        world.for_each_chunk< component_1, component_2 >(
+        [ & ]( const ecs::archetype_chunk< component_1, component_2 >& chunk )
+        {
+            ++chunks;
+            entities += chunk.size();
+            return true;
+        } );
+
+        QVERIFY( chunks == 1 );
+        QVERIFY( entities == 2 );
+    }
+
+    // check that entities move between archetypes
+    {
+        e1.remove_component< component_1 >();
+        e3.add_component< unused_component >();
+
+        uint64_t called{ 0 };
+        ecs::entity* found{ nullptr };
+        world.for_each_with< component_1, component_2 >( [ & ]( ecs::entity& e, component_1&, component_2& )
+        {
+            ++called;
+            found = &e;
+            return true;
+        } );
+
+        QVERIFY( called == 1 );
+        QVERIFY( found == &e2 );
+        QVERIFY( world.get_entities_with_components< component_2 >().size() == 3 );
+        QVERIFY( world.get_entities_with_components< unused_component >().size() == 1 );
+
+        world.remove_entity( e1 );
+        QVERIFY( world.get_entities_with_components< component_2 >().size() == 2 );
+
+        e3.remove_components< component_2, unused_component >();
+        QVERIFY( world.get_entities_with_components< component_2 >().size() == 1 );
+        QVERIFY( world.get_entities_with_components< component_2 >().front() == &e2 );
+    }
+
+    // check signature masks
+    {
+        const ecs::component_mask& mask = ecs::get_component_mask< component_1, component_2 >();
+        QVERIFY( mask.count() == 2 );
+        QVERIFY( e2.get_mask() == mask );
+        QVERIFY( e3.get_mask().none() );
+        bool comps_present{ e2.has_components< component_2, component_1 >() };
+        QVERIFY( comps_present );
+        comps_present = e2.has_components< component_1, unused_component >();
+        QVERIFY( !comps_present );
+    }
+}
+
+void ecs_tests::view_tests()
+{
+    ecs::world world;
+    ecs::entity& e1 = world.create_entity();
+    add_components( e1 );
+
+    // views are cached by the world
+    ecs::query_view< component_1, component_2 >& view = world.view< component_1, component_2 >();
+    ecs::query_view< component_1, component_2 >& same_view = world.view< component_1, component_2 >();
+    QVERIFY( &view == &same_view );
+    QVERIFY( view.size() == 1 );
+    QVERIFY( &*view.begin() == &e1 );
+
+    // check that the view follows the new archetypes and entities
+    {
+        ecs::entity& e2 = world.create_entity();
+        e2.add_component< unused_component >();
+        QVERIFY( view.size() == 1 );
+
+        add_components( e2 );
+        QVERIFY( view.size() == 2 );
+
+        size_t iterated{ 0 };
+        for( ecs::entity& e : view )
+        {
+            QVERIFY( &e == &e1 || &e == &e2 );
+            ++iterated;
+        }
+
+        QVERIFY( iterated == 2 );
+
+        e1.remove_component< component_1 >();
+        QVERIFY( view.size() == 1 );
+        QVERIFY( &*view.begin() == &e2 );
+
+        world.remove_entity( e2 );
+        QVERIFY( view.empty() );
+        QVERIFY( view.begin() == view.end() );
+    }
+
+    // check for_each
+    {
+        e1.add_component< component_1 >();
+
+        uint64_t called{ 0 };
+        bool valid{ true };
+        view.for_each( [ & ]( ecs::entity& e, component_1&, component_2& c )
+        {
+            ++called;
+            valid = &e == &e1 && &c == &e1.get_component< component_2 >();
+            return true;
+        } );
+
+        QVERIFY( called == 1 );
+        QVERIFY( valid );
+    }
+}
+
+void ecs_tests::pool_tests()
+{
+    using test_prefab = ecs::prefab< component_1, component_2 >;
+
+    ecs::world world;
+    ecs::entity& e = world.recycle_or_create< test_prefab >( std::make_tuple(),
+                                                             std::make_tuple( m_component2_data ) );
+    bool comps_present{ e.has_components< component_1, component_2 >() };
+    QVERIFY( comps_present );
+    QVERIFY( e.get_component< component_2 >().data == m_component2_data );
+    QVERIFY( world.get_pool_stats< test_prefab >().misses == 1 );
+    QVERIFY( world.get_pool_stats< test_prefab >().hits == 0 );
+
+    // removed entities of the same shape are recycled
+    {
+        ecs::entity_id old_id{ e.get_id() };
+        component_2* old_component{ &e.get_component< component_2 >() };
+        world.remove_entity( e );
+
+        int new_data{ m_component2_data * 2 };
+        ecs::entity& recycled = world.recycle_or_create< test_prefab >( std::make_tuple(),
+                                                                        std::make_tuple( new_data ) );
+
+        QVERIFY( world.get_pool_stats< test_prefab >().hits == 1 );
+        QVERIFY( &recycled == &e );
+        QVERIFY( &recycled.get_component< component_2 >() == old_component );
+        QVERIFY( recycled.get_component< component_2 >().data == new_data );
+        QVERIFY( recycled.get_state() == ecs::entity_state::ok );
+        QVERIFY( recycled.get_id() != old_id );
+        QVERIFY( !world.entity_present( old_id ) );
+        QVERIFY( world.entity_present( recycled.get_id() ) );
+        QVERIFY( world.get_entities_with_components< component_2 >().size() == 1 );
+    }
+
+    // entities of other shapes are not
+    {
+        e.remove_component< component_1 >();
+        world.remove_entity( e );
+
+        world.recycle_or_create< test_prefab >( std::make_tuple(), std::make_tuple( m_component2_data ) );
+        QVERIFY( world.get_pool_stats< test_prefab >().hits == 1 );
+        QVERIFY( world.get_pool_stats< test_prefab >().misses == 2 );
+    }
+}
+
+void ecs_tests::prefab_tests()
+{
+    using test_prefab = ecs::prefab< component_2, component_1 >;
+
+    ecs::world world;
+
+    int added{ 0 };
+    ecs::observer_id observer{ world.on_added< component_1 >( [ & ]( ecs::entity&, component_1& ){ ++added; } ) };
+
+    ecs::entity& e = world.instantiate< test_prefab >( std::make_tuple( m_component2_data ), std::make_tuple() );
+    bool comps_present{ e.has_components< component_1, component_2 >() };
+    QVERIFY( comps_present );
+    QVERIFY( e.get_component< component_2 >().data == m_component2_data );
+    QVERIFY( added == 1 );
+
+    // the entity is in the same archetype as the one built component by component
+    ecs::entity& built = world.create_entity();
+    add_components( built );
+    QVERIFY( ( world.get_entities_with_components< component_1, component_2 >().size() == 2 ) );
+    QVERIFY( ( world.view< component_1, component_2 >().size() == 2 ) );
+    QVERIFY( e.get_changed_tick< component_2 >() == world.get_change_tick() );
+
+    // nothing is left behind if a constructor throws
+    struct throwing_component
+    {
+        throwing_component(){ throw std::runtime_error{ "" }; }
+    };
+
+    using throwing_prefab = ecs::prefab< component_1, throwing_component >;
+    QVERIFY_EXCEPTION_THROWN( ( world.instantiate< throwing_prefab >( std::make_tuple(), std::make_tuple() ) ),
+                              std::runtime_error );
+    QVERIFY( world.get_entities_with_components< component_1 >().size() == 2 );
+    QVERIFY( added == 2 );
+
+    world.remove_observer( observer );
+}
+
+void ecs_tests::bulk_tests()
+{
+    using test_prefab = ecs::prefab< component_1, component_2 >;
+    static constexpr size_t entities_num{ 1000 };
+
+    ecs::world world;
+
+    int removed{ 0 };
+    ecs::observer_id observer{ world.on_removed< component_2 >( [ & ]( ecs::entity&, component_2& ){ ++removed; } ) };
+
+    std::vector< ecs::entity* > entities{
+        world.create_entities< test_prefab >( entities_num, std::make_tuple(), std::make_tuple( m_component2_data ) ) };
+
+    QVERIFY( entities.size() == entities_num );
+    QVERIFY( world.view< component_2 >().size() == entities_num );
+    QVERIFY( std::all_of( entities.begin(), entities.end(), [ this ]( ecs::entity* e )
+    {
+        return e->get_component< component_2 >().data == m_component2_data;
+    } ) );
+
+    // the removed and the unknown ids are skipped
+    std::vector< ecs::entity_id > ids;
+    for( size_t i{ 0 }; i < entities_num / 2; ++i )
+    {
+        ids.emplace_back( entities[ i ]->get_id() );
+    }
+
+    ids.emplace_back( ids.front() );
+    ids.emplace_back( INVALID_NUMERIC_ID );
+
+    world.destroy_entities( ids );
+    QVERIFY( removed == entities_num / 2 );
+    QVERIFY( !world.entity_present( ids.front() ) );
+    QVERIFY( world.view< component_2 >().size() == entities_num / 2 );
+
+    // entities of other shapes having the component are destroyed as well
+    ecs::entity& other = world.create_entity();
+    other.add_component< component_2 >( 1 );
+
+    ecs::entity& kept = world.create_entity();
+    kept.add_component< component_1 >();
+
+    world.destroy_all_with< component_2 >();
+    QVERIFY( removed == entities_num + 1 );
+    QVERIFY( world.view< component_2 >().empty() );
+    QVERIFY( world.entity_present( kept.get_id() ) );
+
+    // the freed slots are reused
+    world.create_entities< test_prefab >( entities_num, std::make_tuple(), std::make_tuple( 1 ) );
+    QVERIFY( world.view< component_2 >().size() == entities_num );
+
+    world.remove_observer( observer );
+}
+
+void ecs_tests::polymorph_tests()
+{
+    struct large_component
+    {
+        large_component( int d ) noexcept : data( d ){}
+        int data{ 0 };
+        char padding[ ECS_POLYMORPH_INLINE_SIZE ];
+    };
+
+    struct immovable_component
+    {
+        immovable_component() = default;
+        immovable_component( immovable_component&& ) = delete;
+    };
+
+    QVERIFY( ecs::polymorph::stored_inline< component_2 >::value );
+    QVERIFY( !ecs::polymorph::stored_inline< large_component >::value );
+    QVERIFY( !ecs::polymorph::stored_inline< immovable_component >::value );
+
+    ecs::polymorph small{ component_2{ m_component2_data } };
+    ecs::polymorph large;
+    large.emplace< large_component >( m_component2_data );
+
+    QVERIFY( small.check_type< component_2 >() );
+    QVERIFY( !small.check_type< large_component >() );
+    QVERIFY( small.get< component_2 >().data == m_component2_data );
+    QVERIFY( large.get< large_component >().data == m_component2_data );
+#ifdef ECS_POLYMORPH_CHECKS
+    QVERIFY_EXCEPTION_THROWN( small.get< large_component >(), std::bad_cast );
+#endif
+
+    // inline objects are moved, heap ones keep their address
+    {
+        const void* large_data{ large.data() };
+
+        ecs::polymorph moved_small{ std::move( small ) };
+        ecs::polymorph moved_large{ std::move( large ) };
+
+        QVERIFY( small.empty() );
+        QVERIFY( large.empty() );
+        QVERIFY( moved_small.get< component_2 >().data == m_component2_data );
+        QVERIFY( moved_large.data() == large_data );
+    }
+
+    QVERIFY_EXCEPTION_THROWN( small.get< component_2 >(), ecs::polymorph_empty );
+}
+
+void ecs_tests::par_for_each_tests()
+{
+    static constexpr int entities_num{ 10000 };
+
+    ecs::world world;
+    world.set_workers_num( 4 );
+    QVERIFY( world.get_workers_num() == 4 );
+
+    for( int i{ 0 }; i < entities_num; ++i )
+    {
+        ecs::entity& e = world.create_entity();
+        e.add_component< component_2 >( i );
+        if( i % 2 )
+        {
+            e.add_component< component_1 >();
+        }
+    }
+
+    world.par_for_each_with< component_2 >( []( ecs::entity&, component_2& c )
+    {
+        c.data *= 2;
+    } );
+
+    // reduce the per worker sums
+    std::vector< int64_t > sums;
+    world.par_for_each_with< component_2 >( sums, []( int64_t& sum, ecs::entity&, component_2& c )
+    {
+        sum += c.data;
+    } );
+
+    QVERIFY( sums.size() == world.get_workers_num() );
+
+    int64_t total{ 0 };
+    for( int64_t sum : sums )
+    {
+        total += sum;
+    }
+
+    QVERIFY( total == int64_t{ entities_num } * ( entities_num - 1 ) );
+
+    std::atomic< int > visited{ 0 };
+    world.par_for_each_with< component_1, component_2 >( [ & ]( ecs::entity&, component_1&, component_2& )
+    {
+        ++visited;
+    } );
+
+    QVERIFY( visited == entities_num / 2 );
+
+    // exceptions are passed to the caller
+    QVERIFY_EXCEPTION_THROWN( world.par_for_each_with< component_2 >( []( ecs::entity&, component_2& )
+    {
+        throw std::runtime_error{ "" };
+    } ), std::runtime_error );
+
+    // a loop nested in a task of another one is shared with the idle workers:
+    // the tasks meet at a latch, which they can only pass if run by different threads.
+    // The wait is bounded, so that a sequential loop fails instead of hanging
+    std::mutex latch_mutex;
+    std::condition_variable latch_cv;
+    std::unordered_set< std::thread::id > loop_threads;
+    std::atomic< bool > nested_started{ false };
+
+    world.par_for_each_with< component_1 >( [ & ]( ecs::entity&, component_1& )
+    {
+        if( nested_started.exchange( true ) )
+        {
+            return;
+        }
+
+        world.par_for_each_with< component_2 >( [ & ]( ecs::entity&, component_2& )
+        {
+            std::unique_lock< std::mutex > l{ latch_mutex };
+            if( loop_threads.insert( std::this_thread::get_id() ).second )
+            {
+                latch_cv.notify_all();
+            }
+
+            latch_cv.wait_for( l, std::chrono::seconds{ 30 }, [ & ]{ return loop_threads.size() >= 2; } );
+        } );
+    } );
+
+    QVERIFY( loop_threads.size() >= 2 );
+
+    // so is a loop of a system ticked along with another one
+    loop_threads.clear();
+
+    scheduled_system looping{ world, [ & ]
+    {
+        world.par_for_each_with< component_2 >( [ & ]( ecs::entity&, component_2& )
+        {
+            std::unique_lock< std::mutex > l{ latch_mutex };
+            if( loop_threads.insert( std::this_thread::get_id() ).second )
+            {
+                latch_cv.notify_all();
+            }
+
+            latch_cv.wait_for( l, std::chrono::seconds{ 30 }, [ & ]{ return loop_threads.size() >= 2; } );
+        } );
+
+        return true;
+    } };
+
+    scheduled_system other{ world, []{ return true; } };
+    looping.with_reads< component_2 >();
+    other.with_reads< component_2 >();
+
+    world.add_system( looping );
+    world.add_system( other );
+
+    QVERIFY( world.tick() );
+    QVERIFY( loop_threads.size() >= 2 );
+
+    world.remove_system( looping );
+    world.remove_system( other );
+}
+
+void ecs_tests::scheduler_tests()
+{
+    ecs::world world;
+    world.set_workers_num( 2 );
+
+    // both readers meet at the latch, which they can only pass if ticked concurrently.
+    // The wait is bounded, so that a sequential schedule fails instead of hanging
+    std::mutex latch_mutex;
+    std::condition_variable latch_cv;
+    int readers_arrived{ 0 };
+    int readers_met{ 0 };
+    bool readers_meet{ true };
+
+    // systems of the same group see the same change tick
+    uint64_t reader_1_tick{ 0 };
+    uint64_t reader_2_tick{ 0 };
+
+    auto reader_tick = [ & ]( uint64_t& tick )
+    {
+        tick = world.get_change_tick();
+
+        if( readers_meet )
+        {
+            std::unique_lock< std::mutex > l{ latch_mutex };
+            ++readers_arrived;
+            latch_cv.notify_all();
+
+            if( latch_cv.wait_for( l, std::chrono::seconds{ 30 }, [ & ]{ return readers_arrived == 2; } ) )
+            {
+                ++readers_met;
+            }
+        }
+
+        return true;
+    };
+
+    scheduled_system reader_1{ world, [ & ]{ return reader_tick( reader_1_tick ); } };
+    scheduled_system reader_2{ world, [ & ]{ return reader_tick( reader_2_tick ); } };
+    reader_1.with_reads< component_1 >();
+    reader_2.with_reads< component_1, component_2 >();
+
+    // the writer conflicts with both readers and is ticked after them
+    uint64_t writer_tick{ 0 };
+    scheduled_system writer{ world, [ & ]
+    {
+        writer_tick = world.get_change_tick();
+        return true;
+    } };
+    writer.with_writes< component_1 >();
+
+    // no declarations, ticked alone
+    uint64_t undeclared_tick{ 0 };
+    scheduled_system undeclared{ world, [ & ]
+    {
+        undeclared_tick = world.get_change_tick();
+        return false;
+    } };
+
+    bool last_ticked{ false };
+    scheduled_system last{ world, [ & ]{ last_ticked = true; return true; } };
+    last.with_reads< unused_component >();
+
+    world.add_system( reader_1 );
+    world.add_system( reader_2 );
+    world.add_system( writer );
+    world.add_system( undeclared );
+    world.add_system( last );
+
+    QVERIFY( !world.tick() );
+    QVERIFY( readers_met == 2 );
+    QVERIFY( reader_1_tick == reader_2_tick );
+    QVERIFY( writer_tick > reader_1_tick );
+    QVERIFY( undeclared_tick > writer_tick );
+
+    // the systems after the one that has failed aren't ticked
+    QVERIFY( !last_ticked );
+
+    // the handlers of the emitted events are taken into account
+    world.remove_system( undeclared );
+    world.remove_system( last );
+
+    test_system handler{ world };
+    world.subscribe< test_event >( handler );
+
+    readers_meet = false;
+    reader_2.with_emits< test_event >();
+
+    // reader_2 now calls a handler without declarations, so it's ticked apart from reader_1
+    QVERIFY( world.tick() );
+    QVERIFY( reader_1_tick != reader_2_tick );
+
+    world.unsubscribe< test_event >( handler );
+}
+
+void ecs_tests::command_buffer_tests()
+{
+    static constexpr int entities_num{ 1000 };
+
+    ecs::world world;
+    world.set_workers_num( 4 );
+
+    for( int i{ 0 }; i < entities_num; ++i )
+    {
+        world.create_entity().add_component< component_2 >( i );
+    }
+
+    // structural changes recorded by the workers aren't visible until the playback
+    world.par_for_each_with< component_2 >( [ & ]( ecs::entity& e, component_2& c )
+    {
+        ecs::command_buffer& commands = world.get_command_buffer();
+        if( c.data % 2 )
+        {
+            commands.add_component< component_1 >( e.get_id() );
+        }
+        else
+        {
+            commands.destroy_entity( e.get_id() );
+        }
+    } );
+
+    QVERIFY( world.get_entities_with_components< component_1 >().empty() );
+    QVERIFY( world.get_entities_with_components< component_2 >().size() == entities_num );
+
+    world.play_commands();
+
+    QVERIFY( world.get_entities_with_components< component_1 >().size() == entities_num / 2 );
+    QVERIFY( world.get_entities_with_components< component_2 >().size() == entities_num / 2 );
+    QVERIFY( world.get_command_buffer().empty() );
+
+    // commands are played back in the recording order
+    ecs::entity_id id{ world.get_entities_with_components< component_1 >().front()->get_id() };
+    ecs::command_buffer& commands = world.get_command_buffer();
+    commands.remove_components< component_1, component_2 >( id );
+    commands.add_component< component_2 >( id, m_component2_data );
+
+    int created{ 0 };
+    commands.create_entity( [ & ]( ecs::entity& e )
+    {
+        e.add_component< unused_component >();
+        ++created;
+    } );
+
+    world.play_commands();
+
+    ecs::entity& e = world.get_entity( id );
+    QVERIFY( !e.has_component< component_1 >() );
+    QVERIFY( e.get_component< component_2 >().data == m_component2_data );
+    QVERIFY( created == 1 );
+    QVERIFY( world.get_entities_with_components< unused_component >().size() == 1 );
+
+    // the created entity may come from a pool
+    using pooled_prefab = ecs::prefab< component_1, unused_component >;
+    commands.create_entity( []( ecs::world& w ) -> ecs::entity&
+    {
+        return w.recycle_or_create< pooled_prefab >( std::make_tuple(), std::make_tuple() );
+    },
+    [ & ]( ecs::entity& e )
+    {
+        QVERIFY( ( e.has_components< component_1, unused_component >() ) );
+        ++created;
+    } );
+
+    world.play_commands();
+
+    QVERIFY( created == 2 );
+    QVERIFY( world.get_pool_stats< pooled_prefab >().misses == 1 );
+
+    // commands targeting removed entities are skipped, the world is played back by tick()
+    world.schedule_remove_entity( id );
+    QVERIFY( e.get_state() == ecs::entity_state::invalid );
+    commands.add_component< component_1 >( id );
+    commands.destroy_entity( id );
+
+    world.tick();
+
+    QVERIFY( !world.entity_present( id ) );
+
+    // other threads may schedule removals as well
+    ecs::entity_id other_id{ world.get_entities_with_components< component_2 >().front()->get_id() };
+    std::thread{ [ & ]{ world.schedule_remove_entity( other_id ); } }.join();
+
+    world.tick();
+
+    QVERIFY( !world.entity_present( other_id ) );
+
+    // the commands are played back in the schedule order of the systems, whichever workers have run them
+    {
+        ecs::world ordered_world;
+        ordered_world.set_workers_num( 4 );
+
+        ecs::entity_id anchor{ ordered_world.create_entity().get_id() };
+        for( int i{ 0 }; i < entities_num; ++i )
+        {
+            ordered_world.create_entity().add_component< component_2 >( i );
+        }
+
+        std::vector< int > played;
+        auto record = [ & ]( int value )
+        {
+            ordered_world.get_command_buffer().apply( anchor, [ &played, value ]( ecs::entity& )
+            {
+                played.emplace_back( value );
+            } );
+        };
+
+        scheduled_system looping{ ordered_world, [ & ]
+        {
+            record( -1 );
+            ordered_world.par_for_each_with< component_2 >( [ & ]( ecs::entity&, component_2& c )
+            {
+                record( c.data );
+            } );
+
+            record( -2 );
+            return true;
+        } };
+
+        scheduled_system second{ ordered_world, [ & ]{ record( -3 ); return true; } };
+        scheduled_system third{ ordered_world, [ & ]{ record( -4 ); return true; } };
+        looping.with_reads< component_2 >();
+        second.with_reads< component_2 >();
+        third.with_reads< component_2 >();
+
+        ordered_world.add_system( looping );
+        ordered_world.add_system( second );
+        ordered_world.add_system( third );
+
+        std::vector< int > expected{ -1 };
+        for( int i{ 0 }; i < entities_num; ++i )
+        {
+            expected.emplace_back( i );
+        }
+
+        expected.insert( expected.end(), { -2, -3, -4 } );
+
+        for( int i{ 0 }; i < 20; ++i )
+        {
+            played.clear();
+            QVERIFY( ordered_world.tick() );
+            QVERIFY( played == expected );
+        }
+
+        ordered_world.remove_system( looping );
+        ordered_world.remove_system( second );
+        ordered_world.remove_system( third );
+    }
+}
+
+void ecs_tests::queued_events_tests()
+{
+    struct batch_callback : public ecs::event_callback< test_event >
+    {
+        void on_event( const test_event& ) override{ ++single; }
+        void on_events( const ecs::event_span< test_event >& events ) override
+        {
+            ++batches;
+            for( const test_event& e : events )
+            {
+                sum += e.data;
+            }
+        }
+
+        int single{ 0 };
+        int batches{ 0 };
+        int sum{ 0 };
+    };
+
+    ecs::world world;
+    world.set_workers_num( 4 );
+
+    test_system system{ world };
+    batch_callback callback;
+    world.subscribe< test_event >( system );
+    world.subscribe< test_event >( callback );
+
+    bool queued{ world.is_event_queued< test_event >() };
+    QVERIFY( !queued );
+
+    world.set_event_queued< test_event >();
+    queued = world.is_event_queued< test_event >();
+    QVERIFY( queued );
+
+    world.emit_event( test_event{ 1 } );
+    world.emit_event( test_event{ 2 } );
+    QVERIFY( system.data == test_system::data_default_val );
+    QVERIFY( callback.batches == 0 );
+
+    // the whole batch is delivered at once, the default on_events() calls on_event() for each event
+    world.dispatch_events();
+    QVERIFY( system.data == 2 );
+    QVERIFY( callback.batches == 1 );
+    QVERIFY( callback.sum == 3 );
+    QVERIFY( callback.single == 0 );
+
+    // events may be emitted concurrently
+    for( int i{ 0 }; i < 1000; ++i )
+    {
+        world.create_entity().add_component< component_2 >( 1 );
+    }
+
+    world.par_for_each_with< component_2 >( [ & ]( ecs::entity&, component_2& c )
+    {
+        world.emit_event( test_event{ c.data } );
+    } );
+
+    // queued events are delivered by tick()
+    world.tick();
+    QVERIFY( callback.batches == 2 );
+    QVERIFY( callback.sum == 1003 );
+
+    // the pending events are delivered once the queue is disabled
+    world.emit_event( test_event{ 7 } );
+    world.set_event_queued< test_event >( false );
+    QVERIFY( callback.sum == 1010 );
+
+    world.emit_event( test_event{ 5 } );
+    QVERIFY( callback.single == 1 );
+    QVERIFY( system.data == 5 );
+
+    world.unsubscribe< test_event >( system );
+    world.unsubscribe< test_event >( callback );
+}
+
+void ecs_tests::entity_events_tests()
+{
+    struct entity_callback : public ecs::event_callback< entity_event >
+    {
+        void on_event( const entity_event& e ) override{ causes.emplace_back( e.cause ); }
+        std::vector< ecs::entity* > causes;
+    };
+
+    ecs::world world;
+    ecs::entity& first = world.create_entity();
+    ecs::entity& second = world.create_entity();
+
+    entity_callback first_callback;
+    entity_callback second_callback;
+    entity_callback all_callback;
+
+    world.subscribe_for< entity_event >( first.get_id(), first_callback );
+    world.subscribe_for< entity_event >( second.get_id(), second_callback );
+    world.subscribe< entity_event >( all_callback );
+
+    world.emit_event( entity_event{ first } );
+    world.emit_event( entity_event{ second } );
+    world.emit_event( entity_event{ second } );
+
+    QVERIFY( first_callback.causes.size() == 1 && first_callback.causes.front() == &first );
+    QVERIFY( second_callback.causes.size() == 2 && second_callback.causes.back() == &second );
+    QVERIFY( all_callback.causes.size() == 3 );
+
+    // queued events are routed as well
+    world.set_event_queued< entity_event >();
+    world.emit_event( entity_event{ first } );
+    QVERIFY( first_callback.causes.size() == 1 );
+
+    world.dispatch_events();
+    QVERIFY( first_callback.causes.size() == 2 );
+    QVERIFY( second_callback.causes.size() == 2 );
+
+    world.set_event_queued< entity_event >( false );
+
+    world.unsubscribe_for< entity_event >( first.get_id(), first_callback );
+    world.emit_event( entity_event{ first } );
+    QVERIFY( first_callback.causes.size() == 2 );
+    QVERIFY( all_callback.causes.size() == 5 );
+
+    world.unsubscribe_for< entity_event >( second.get_id(), second_callback );
+    world.unsubscribe< entity_event >( all_callback );
+
+    // callbacks of single entities may come and go on another thread while the events are emitted
+    std::vector< std::unique_ptr< entity_callback > > callbacks;
+    for( int i{ 0 }; i < 100; ++i )
+    {
+        callbacks.emplace_back( new entity_callback );
+    }
+
+    std::thread subscriber{ [ & ]
+    {
+        for( int round{ 0 }; round < 20; ++round )
+        {
+            for( auto& callback : callbacks )
+            {
+                world.subscribe_for< entity_event >( second.get_id(), *callback );
+            }
+
+            for( auto& callback : callbacks )
+            {
+                world.unsubscribe_for< entity_event >( second.get_id(), *callback );
+            }
+        }
+    } };
+
+    for( int i{ 0 }; i < 1000; ++i )
+    {
+        world.emit_event( entity_event{ second } );
+    }
+
+    subscriber.join();
+
+    world.emit_event( entity_event{ second } );
+    QVERIFY( second_callback.causes.size() == 2 );
+}
+
+void ecs_tests::input_tests()
+{
+    struct sum_callback : public ecs::event_callback< test_event >
+    {
+        void on_event( const test_event& e ) override{ sum += e.data; ++received; }
+        int64_t sum{ 0 };
+        int received{ 0 };
+    };
+
+    static constexpr int threads_num{ 4 };
+    static constexpr int events_per_thread{ 10000 };
+
+    ecs::world world;
+    sum_callback callback;
+    world.subscribe< test_event >( callback );
+    world.register_input< test_event >( 64 );
+
+    // the events are delivered at the beginning of the tick, the producers retry when the queue is full
+    std::atomic< bool > producing{ true };
+    std::vector< std::thread > producers;
+    for( int t{ 0 }; t < threads_num; ++t )
+    {
+        producers.emplace_back( [ & ]
+        {
+            for( int i{ 1 }; i <= events_per_thread; ++i )
+            {
+                while( !world.post_input( test_event{ i } ) )
+                {
+                    std::this_thread::yield();
+                }
+            }
+        } );
+    }
+
+    std::thread finisher{ [ & ]
+    {
+        for( std::thread& producer : producers )
+        {
+            producer.join();
+        }
+
+        producing = false;
+    } };
+
+    while( producing )
+    {
+        world.tick();
+    }
+
+    finisher.join();
+    world.tick();
+
+    QVERIFY( callback.received == threads_num * events_per_thread );
+    QVERIFY( callback.sum == int64_t{ threads_num } * events_per_thread * ( events_per_thread + 1 ) / 2 );
+
+    // nothing is delivered outside of the tick
+    QVERIFY( world.post_input( test_event{ 1 } ) );
+    QVERIFY( callback.received == threads_num * events_per_thread );
+
+    // the capacity is rounded up to a power of two
+    ecs::world small_world;
+    small_world.register_input< test_event >( 3 );
+    for( int i{ 0 }; i < 4; ++i )
+    {
+        QVERIFY( small_world.post_input( test_event{ i } ) );
+    }
+
+    QVERIFY( !small_world.post_input( test_event{ 4 } ) );
+
+    world.unsubscribe< test_event >( callback );
+}
+
+void ecs_tests::lock_policy_tests()
+{
+    struct spin_component : public ecs::use_lock< ecs::spinlock >{ int data{ 0 }; };
+    struct rw_spin_component : public ecs::use_lock< ecs::rw_spinlock >{ int data{ 0 }; };
+    struct no_lock_component : public ecs::use_lock< ecs::no_lock >{ int data{ 0 }; };
+    struct plain_component{ int data{ 0 }; };
+
+    // the policy is deduced from the base
+    bool spin_policy{ std::is_same< ecs::lock_policy_of< spin_component >::lock_type, ecs::spinlock >::value };
+    bool rw_spin_policy{ std::is_same< ecs::lock_policy_of< rw_spin_component >::lock_type, ecs::rw_spinlock >::value };
+    bool plain_policy{ std::is_same< ecs::lock_policy_of< plain_component >::lock_type, ecs::no_lock >::value };
+    QVERIFY( spin_policy );
+    QVERIFY( rw_spin_policy );
+    QVERIFY( plain_policy );
+
+    // no_lock takes no space
+    QVERIFY( sizeof( no_lock_component ) == sizeof( plain_component ) );
+    QVERIFY( sizeof( rw_spin_component ) < sizeof( ecs::rw_lock ) );
+
+    spin_component spin;
+    {
+        ecs::lock_guard_for< spin_component > l{ spin, ecs::lock_mode::read };
+        QVERIFY( l.owns_lock() );
+
+        // both modes are exclusive for a spinlock
+        QVERIFY( !spin.try_lock( ecs::lock_mode::read ) );
+    }
+
+    QVERIFY( spin.try_lock( ecs::lock_mode::write ) );
+    spin.unlock( ecs::lock_mode::write );
+
+    rw_spin_component rw_spin;
+    {
+        ecs::lock_guard_for< rw_spin_component > l{ rw_spin, ecs::lock_mode::read };
+        QVERIFY( rw_spin.try_lock( ecs::lock_mode::read ) );
+        QVERIFY( !rw_spin.try_lock( ecs::lock_mode::write ) );
+        rw_spin.unlock( ecs::lock_mode::read );
+    }
+
+    QVERIFY( rw_spin.try_lock( ecs::lock_mode::write ) );
+    rw_spin.unlock( ecs::lock_mode::write );
+
+    // a timed writer holds back the new readers, so a steady stream of them doesn't starve it
+    {
+        ecs::rw_spinlock lock;
+        std::atomic< bool > stop{ false };
+        std::atomic< int > readers_started{ 0 };
+        std::vector< std::thread > readers;
+
+        for( int i{ 0 }; i < 4; ++i )
+        {
+            readers.emplace_back( [ & ]
+            {
+                ++readers_started;
+                while( !stop )
+                {
+                    lock.lock( ecs::lock_mode::read );
+                    for( int spin{ 0 }; spin < 1000; ++spin )
+                    {
+                        ecs::_detail::cpu_relax();
+                    }
+
+                    lock.unlock( ecs::lock_mode::read );
+                }
+            } );
+        }
+
+        while( readers_started != 4 )
+        {
+            std::this_thread::yield();
+        }
+
+        bool written{ lock.try_lock_for( ecs::lock_mode::write, std::chrono::seconds{ 5 } ) };
+        if( written )
+        {
+            lock.unlock( ecs::lock_mode::write );
+        }
+
+        stop = true;
+        for( std::thread& reader : readers )
+        {
+            reader.join();
+        }
+
+        QVERIFY( written );
+
+        // a timed out writer is withdrawn and lets the readers in again
+        lock.lock( ecs::lock_mode::read );
+        QVERIFY( !lock.try_lock_for( ecs::lock_mode::write, std::chrono::milliseconds{ 1 } ) );
+        QVERIFY( lock.try_lock( ecs::lock_mode::read ) );
+        lock.unlock( ecs::lock_mode::read );
+        lock.unlock( ecs::lock_mode::read );
+    }
+
+    // guards of the components without a lock are no-ops
+    plain_component plain;
+    ecs::lock_guard_for< plain_component > l{ plain, ecs::lock_mode::write, ecs::lock_policy::defer };
+    QVERIFY( !l.owns_lock() );
+    QVERIFY( l.try_lock_for( std::chrono::milliseconds{ 1 } ) );
+}
+
+void ecs_tests::change_tracking_tests()
+{
+    ecs::world world;
+
+    ecs::entity& tile = world.create_entity();
+    tile.add_component< component_1 >();
+    tile.add_component< component_2 >( 1 );
+
+    ecs::entity& tank = world.create_entity();
+    tank.add_component< component_2 >( 2 );
+
+    auto changed_since = [ & ]( uint64_t tick )
+    {
+        std::vector< int > changed;
+        world.for_each_changed_since< component_2 >( tick, [ & ]( ecs::entity&, component_2& c )
+        {
+            changed.emplace_back( c.data );
+            return true;
+        } );
+
+        return changed;
+    };
+
+    // added components count as changed
+    QVERIFY( changed_since( 0 ).size() == 2 );
+
+    // a system remembers the tick it has started at and only gets the changes made since then
+    uint64_t last_seen{ 0 };
+    std::vector< int > seen;
+    scheduled_system watcher{ world, [ & ]
+    {
+        uint64_t since{ last_seen };
+        last_seen = world.get_change_tick();
+        seen = changed_since( since );
+        return true;
+    } };
+    watcher.with_reads< component_2 >();
+
+    scheduled_system mover{ world, [ & ]
+    {
+        tank.get_component_mut< component_2 >().data = 3;
+        return true;
+    } };
+    mover.with_writes< component_2 >();
+
+    world.add_system( watcher );
+    world.add_system( mover );
+
+    QVERIFY( world.tick() );
+    QVERIFY( seen.size() == 2 );
+
+    // the change made by the mover after the watcher is seen on the next tick
+    QVERIFY( world.tick() );
+    QVERIFY( seen == std::vector< int >{ 3 } );
+
+    world.remove_system( mover );
+    QVERIFY( world.tick() );
+    QVERIFY( seen.size() == 1 );
+    QVERIFY( world.tick() );
+    QVERIFY( seen.empty() );
+
+    // changes made between the ticks or through mark_changed()
+    tile.get_component< component_2 >().data = 4;
+    tile.mark_changed< component_2 >();
+    QVERIFY( world.tick() );
+    QVERIFY( seen == std::vector< int >{ 4 } );
+    QVERIFY( tile.get_changed_tick< component_2 >() > tank.get_changed_tick< component_2 >() );
+
+    // marking a missing component does nothing
+    tank.mark_changed< component_1 >();
+    QVERIFY( !tank.has_component< component_1 >() );
+
+    // the archetypes without changes are skipped, the views filter the same way
+    uint64_t tick{ world.get_change_tick() };
+    QVERIFY( changed_since( tick ).empty() );
+
+    ecs::entity& moved = world.create_entity();
+    moved.add_component< component_2 >( 5 );
+    moved.add_component< component_1 >();
+
+    std::vector< int > view_changed;
+    world.view< component_2, component_1 >().for_each_changed_since( tick - 1, [ & ]( ecs::entity&, component_2& c, component_1& )
+    {
+        view_changed.emplace_back( c.data );
+        return true;
+    } );
+
+    QVERIFY( view_changed == std::vector< int >{ 5 } );
+    QVERIFY( changed_since( tick - 1 ) == std::vector< int >{ 5 } );
+
+    world.remove_system( watcher );
+}
+
+void ecs_tests::observer_tests()
+{
+    ecs::world world;
+
+    std::vector< int > added;
+    std::vector< int > removed;
+
+    ecs::observer_id on_added{ world.on_added< component_2 >( [ & ]( ecs::entity& e, component_2& c )
+    {
+        QVERIFY( e.has_component< component_2 >() );
+        added.emplace_back( c.data );
+    } ) };
+
+    ecs::observer_id on_removed{ world.on_removed< component_2 >( [ & ]( ecs::entity& e, component_2& c )
+    {
+        // the component still exists
+        QVERIFY( e.has_component< component_2 >() );
+        removed.emplace_back( c.data );
+    } ) };
+
+    ecs::entity& e1 = world.create_entity();
+    e1.add_component< component_1 >();
+    QVERIFY( added.empty() );
+
+    e1.add_component< component_2 >( 1 );
+    QVERIFY( added == std::vector< int >{ 1 } );
+
+    e1.remove_component< component_2 >();
+    QVERIFY( removed == std::vector< int >{ 1 } );
+    QVERIFY( !e1.has_component< component_2 >() );
+
+    // deferred changes are observed when the commands are played back
+    ecs::entity_id e2_id{ world.create_entity().get_id() };
+    world.get_entity( e2_id ).add_component< component_1 >();
+
+    world.get_command_buffer().add_component< component_2 >( e2_id, 2 );
+    QVERIFY( added.size() == 1 );
+    world.play_commands();
+    QVERIFY( added == ( std::vector< int >{ 1, 2 } ) );
+
+    // removing the entity removes all of its components
+    world.schedule_remove_entity( e2_id );
+    QVERIFY( removed.size() == 1 );
+    world.play_commands();
+    QVERIFY( removed == ( std::vector< int >{ 1, 2 } ) );
+
+    // recycled entities are observed as new ones
+    using shape = ecs::prefab< component_1, component_2 >;
+    ecs::entity& pooled = world.recycle_or_create< shape >( std::make_tuple(), std::make_tuple( 3 ) );
+    world.remove_entity( pooled );
+    world.recycle_or_create< shape >( std::make_tuple(), std::make_tuple( 4 ) );
+
+    QVERIFY( world.get_pool_stats< shape >().hits == 1 );
+    QVERIFY( added == ( std::vector< int >{ 1, 2, 3, 4 } ) );
+    QVERIFY( removed == ( std::vector< int >{ 1, 2, 3 } ) );
+
+    // observers aren't called once removed and on reset
+    world.remove_observer( on_added );
+    e1.add_component< component_2 >( 5 );
+    QVERIFY( added.size() == 4 );
+
+    world.reset();
+    QVERIFY( removed.size() == 3 );
+
+    world.remove_observer( on_removed );
+}
+
+void ecs_tests::resource_tests()
+{
+    struct map_size{ int width; int height; };
+
+    ecs::world world;
+    QVERIFY( !world.has_resource< map_size >() );
+    QVERIFY_EXCEPTION_THROWN( world.resource< map_size >(), std::out_of_range );
+
+    world.set_resource< map_size >( map_size{ 13, 13 } );
+    QVERIFY( world.has_resource< map_size >() );
+    QVERIFY( world.resource< map_size >().width == 13 );
+
+    // the resource is stored by the world, not by an entity
+    world.resource< map_size >().height = 26;
+    const ecs::world& const_world = world;
+    QVERIFY( const_world.resource< map_size >().height == 26 );
+    QVERIFY( world.get_entities_with_components< component_1 >().empty() );
+
+    // set_resource() replaces the current one
+    world.set_resource< map_size >( map_size{ 1, 2 } );
+    QVERIFY( world.resource< map_size >().height == 2 );
+
+    world.set_resource< component_2 >( 1 );
+    world.remove_resource< component_2 >();
+    QVERIFY( !world.has_resource< component_2 >() );
+    QVERIFY( world.has_resource< map_size >() );
+
+    // removed along with the entities
+    world.reset();
+    QVERIFY( !world.has_resource< map_size >() );
+}
+
+void ecs_tests::traversability_tests()
+{
+    using game::cell_layer;
+
+    // the second word of a row only has 6 cells, the rest are padding
+    game::traversability_map map;
+    map.resize( 3, 70 );
+    QVERIFY( map.get_rows_count() == 3 && map.get_columns_count() == 70 );
+    QVERIFY( map.count_free_cells() == 210 );
+
+    std::vector< size_t > cells;
+    map.get_free_cells( cells );
+    QVERIFY( cells.size() == 210 && cells.back() == 209 );
+
+    // cells outside the map are ignored
+    map.set_blocked( cell_layer::tiles, 0, 70, true );
+    map.set_blocked( cell_layer::tiles, -1, 0, true );
+    QVERIFY( map.count_free_cells() == 210 );
+    QVERIFY( !map.is_blocked( cell_layer::tiles, 0, 70 ) );
+
+    map.set_blocked( cell_layer::tiles, 1, 3, true );
+    map.set_blocked( cell_layer::objects, 1, 69, true );
+    map.set_blocked( cell_layer::tiles, 2, 10, true );
+    QVERIFY( map.is_blocked( cell_layer::objects, 1, 69 ) );
+    QVERIFY( !map.is_blocked( cell_layer::tiles, 1, 69 ) );
+
+    // a cell is free if it's free in both layers
+    QVERIFY( map.count_free_cells() == 207 );
+    map.get_free_cells( cells );
+    QVERIFY( cells.size() == 207 );
+    QVERIFY( std::find( cells.begin(), cells.end(), 73 ) == cells.end() );
+    QVERIFY( std::find( cells.begin(), cells.end(), 139 ) == cells.end() );
+    QVERIFY( std::find( cells.begin(), cells.end(), 150 ) == cells.end() );
+    QVERIFY( std::is_sorted( cells.begin(), cells.end() ) );
+
+    // ranges are clamped to the map, empty ones are free
+    QVERIFY( !map.is_free( cell_layer::tiles, 0, 0, 2, 69 ) );
+    QVERIFY( map.is_free( cell_layer::tiles, 0, 11, 2, 200 ) );
+    QVERIFY( !map.is_free( cell_layer::objects, -5, 60, 1, 100 ) );
+    QVERIFY( map.is_free( cell_layer::objects, 0, 60, 0, 100 ) );
+    QVERIFY( map.is_free( cell_layer::tiles, 5, 0, 9, 9 ) );
+    QVERIFY( map.is_free( cell_layer::tiles, 1, 4, 1, 2 ) );
+
+    // scans go across the words in both directions
+    QVERIFY( map.find_blocked_in_row( cell_layer::objects, 1, 0, true ) == 69 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 1, 4, true ) == -1 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 2, 65, false ) == 10 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 2, 10, false ) == 10 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 2, 9, false ) == -1 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 2, 0, true ) == 10 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 2, 11, true ) == -1 );
+
+    // scans starting outside the map find nothing
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 2, 70, false ) == -1 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 2, -1, true ) == -1 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 3, 0, true ) == -1 );
+    QVERIFY( map.find_blocked_in_column( cell_layer::tiles, 70, 0, true ) == -1 );
+
+    map.set_blocked( cell_layer::tiles, 0, 64, true );
+    map.set_blocked( cell_layer::tiles, 2, 64, true );
+    QVERIFY( map.find_blocked_in_column( cell_layer::tiles, 64, 1, false ) == 0 );
+    QVERIFY( map.find_blocked_in_column( cell_layer::tiles, 64, 1, true ) == 2 );
+    QVERIFY( map.find_blocked_in_column( cell_layer::tiles, 3, 2, false ) == 1 );
+    QVERIFY( map.find_blocked_in_column( cell_layer::tiles, 3, 2, true ) == -1 );
+
+    map.set_blocked( cell_layer::tiles, 0, 64, false );
+    QVERIFY( map.find_blocked_in_column( cell_layer::tiles, 64, 1, false ) == -1 );
+
+    map.clear( cell_layer::objects );
+    QVERIFY( map.find_blocked_in_row( cell_layer::objects, 1, 0, true ) == -1 );
+    QVERIFY( map.count_free_cells() == 207 );
+
+    // rows of whole words have no padding
+    map.resize( 2, 128 );
+    QVERIFY( map.count_free_cells() == 256 );
+    QVERIFY( map.is_free( cell_layer::tiles, 0, 0, 1, 127 ) );
+
+    map.set_blocked( cell_layer::tiles, 1, 127, true );
+    map.set_blocked( cell_layer::objects, 0, 63, true );
+    QVERIFY( map.count_free_cells() == 254 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 1, 0, true ) == 127 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 1, 127, false ) == 127 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::objects, 0, 127, false ) == 63 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::objects, 0, 64, true ) == -1 );
+    QVERIFY( map.find_blocked_in_row( cell_layer::tiles, 1, 128, false ) == -1 );
+    QVERIFY( !map.is_free( cell_layer::tiles, 0, 64, 1, 127 ) );
+    QVERIFY( map.is_free( cell_layer::tiles, 0, 0, 1, 126 ) );
+
+    map.get_free_cells( cells );
+    QVERIFY( cells.size() == 254 && cells.back() == 254 );
+    QVERIFY( std::find( cells.begin(), cells.end(), 63 ) == cells.end() );
+
+    // resizing drops the contents
+    map.resize( 1, 1 );
+    QVERIFY( map.count_free_cells() == 1 );
+    QVERIFY_EXCEPTION_THROWN( map.resize( -1, 1 ), std::invalid_argument );
+}
+
+void ecs_tests::spatial_grid_tests()
+{
+    using game::component::geometry;
+
+    ecs::world world;
+    ecs::entity& first = world.create_entity();
+    ecs::entity& second = world.create_entity();
+    ecs::entity& outside = world.create_entity();
+    ecs::entity& tile = world.create_entity();
+
+    // the first object spans 4 cells
+    first.add_component< geometry >( QRect{ 5, 5, 10, 10 } );
+    second.add_component< geometry >( QRect{ 50, 50, 5, 5 } );
+    outside.add_component< geometry >( QRect{ -20, -20, 5, 5 } );
+    tile.add_component< geometry >( QRect{ 30, 30, 10, 10 } );
+    tile.add_component< game::component::tile_object >();
+
+    game::spatial_grid grid{ QRect{ 0, 0, 100, 100 }, QSize{ 10, 10 } };
+    grid.rebuild( world );
+
+    QVERIFY( grid.contains( first ) && grid.contains( second ) && grid.contains( outside ) );
+    QVERIFY( !grid.contains( tile ) );
+
+    auto query = [ & ]( const QRect& rect )
+    {
+        std::vector< ecs::entity* > found;
+        grid.query_aabb( rect, [ & ]( ecs::entity& e, const QRect& )
+        {
+            found.emplace_back( &e );
+            return true;
+        } );
+
+        return found;
+    };
+
+    // objects met in several cells are reported once
+    std::vector< ecs::entity* > found{ query( QRect{ 0, 0, 30, 30 } ) };
+    QVERIFY( found.size() == 1 && found.front() == &first );
+    QVERIFY( query( QRect{ 12, 12, 2, 2 } ).size() == 1 );
+    QVERIFY( query( QRect{ 16, 16, 2, 2 } ).empty() );
+
+    // objects outside the area go to the border cells, but only the intersecting ones are reported
+    found = query( QRect{ -25, -25, 10, 10 } );
+    QVERIFY( found.size() == 1 && found.front() == &outside );
+    QVERIFY( query( QRect{ -50, -50, 500, 500 } ).size() == 3 );
+
+    // the query stops once func returns false
+    int calls{ 0 };
+    grid.query_aabb( QRect{ -50, -50, 500, 500 }, [ & ]( ecs::entity&, const QRect& ){ ++calls; return false; } );
+    QVERIFY( calls == 1 );
+
+    // queries don't modify the grid, so they may be nested or run concurrently
+    {
+        const game::spatial_grid& const_grid = grid;
+        int outer{ 0 };
+        int inner{ 0 };
+
+        const_grid.query_aabb( QRect{ -50, -50, 500, 500 }, [ & ]( ecs::entity&, const QRect& )
+        {
+            ++outer;
+            const_grid.query_aabb( QRect{ 0, 0, 30, 30 }, [ & ]( ecs::entity&, const QRect& ){ ++inner; return true; } );
+            return true;
+        } );
+
+        QVERIFY( outer == 3 );
+        QVERIFY( inner == 3 );
+    }
+
+    // moving across the cells
+    grid.update( first, QRect{ 85, 5, 10, 10 } );
+    QVERIFY( query( QRect{ 0, 0, 30, 30 } ).empty() );
+    found = query( QRect{ 90, 0, 10, 10 } );
+    QVERIFY( found.size() == 1 && found.front() == &first );
+
+    grid.remove( first );
+    QVERIFY( !grid.contains( first ) );
+    QVERIFY( query( QRect{ 90, 0, 10, 10 } ).empty() );
+
+    // removed items are reused
+    grid.insert( first, QRect{ 0, 0, 5, 5 } );
+    found = query( QRect{ 0, 0, 5, 5 } );
+    QVERIFY( found.size() == 1 && found.front() == &first );
+
+    // sync() picks up the geometry changed through get_component_mut()
+    second.get_component_mut< geometry >().set_pos( QPoint{ 70, 20 } );
+    grid.sync( world );
+    QVERIFY( query( QRect{ 50, 50, 5, 5 } ).empty() );
+    found = query( QRect{ 70, 20, 5, 5 } );
+    QVERIFY( found.size() == 1 && found.front() == &second );
+
+    grid.clear();
+    QVERIFY( query( QRect{ -50, -50, 500, 500 } ).empty() );
+    QVERIFY_EXCEPTION_THROWN( ( game::spatial_grid{ QRect{ 0, 0, 10, 10 }, QSize{ 0, 10 } } ), std::invalid_argument );
+}
+
+void ecs_tests::type_index_lookup_benchmark()
+{
+    std::unordered_map< std::type_index, int > components{ { typeid( component_1 ), 1 },
+                                                           { typeid( component_2 ), 2 },
+                                                           { typeid( unused_component ), 3 } };
+    int64_t sum{ 0 };
+
+    QBENCHMARK
+    {
+        for( int i{ 0 }; i < lookups_num; ++i )
+        {
+            sum += components.at( typeid( component_1 ) ) + components.at( typeid( component_2 ) );
+        }
+    }
+
+    QVERIFY( sum != 0 );
+}
+
+void ecs_tests::dense_id_lookup_benchmark()
+{
+    ecs::type_id id_1{ ecs::get_type_id< component_1 >() };
+    ecs::type_id id_2{ ecs::get_type_id< component_2 >() };
+    ecs::type_id id_unused{ ecs::get_type_id< unused_component >() };
+
+    std::vector< int > components( ecs::registered_types_num() );
+    components[ id_1 ] = 1;
+    components[ id_2 ] = 2;
+    components[ id_unused ] = 3;
+    int64_t sum{ 0 };
+
+    QBENCHMARK
+    {
+        for( int i{ 0 }; i < lookups_num; ++i )
+        {
+            sum += components[ ecs::get_type_id< component_1 >() ] +
+                   components[ ecs::get_type_id< component_2 >() ];
+        }
+    }
+
+    QVERIFY( sum != 0 );
+}
+
+void ecs_tests::entity_lookup_benchmark()
+{
+    ecs::world world;
+    ecs::entity& e = world.create_entity();
+    add_components( e );
+    int64_t sum{ 0 };
+
+    QBENCHMARK
+    {
+        for( int i{ 0 }; i < lookups_num; ++i )
+        {
+            if( e.has_components< component_1, component_2 >() )
+            {
+                sum += e.get_component< component_2 >().data;
+            }
+        }
+    }
+
+    QVERIFY( sum != 0 );
+}
+
+// Every thread does ops_num operations, write_percent of them under the write lock.
+// Returns the number of writes seen by the shared counter
+template< typename lock_type >
+int64_t run_contention( int threads_num, int write_percent, int ops_num )
+{
+    lock_type lock;
+    int64_t counter{ 0 };
+    std::atomic< int64_t > read_sum{ 0 };
+
+    std::vector< std::thread > threads;
+    for( int t{ 0 }; t < threads_num; ++t )
+    {
+        threads.emplace_back( [ & ]
+        {
+            int64_t local_sum{ 0 };
+            for( int i{ 0 }; i < ops_num; ++i )
+            {
+                if( i % 100 < write_percent )
+                {
+                    ecs::rw_lock_guard< lock_type > l{ lock, ecs::lock_mode::write };
+                    ++counter;
+                }
+                else
+                {
+                    ecs::rw_lock_guard< lock_type > l{ lock, ecs::lock_mode::read };
+                    local_sum += counter;
+                }
+            }
+
+            read_sum += local_sum;
+        } );
+    }
+
+    for( std::thread& t : threads )
+    {
+        t.join();
+    }
+
+    return counter;
+}
+
+void ecs_tests::add_components_benchmark()
+{
+    ecs::world world;
+
+    QBENCHMARK
+    {
+        for( int i{ 0 }; i < 1000; ++i )
+        {
+            ecs::entity& e = world.create_entity();
+            e.add_component< component_2 >( i );
+            e.add_component< component_1 >();
+            e.add_component< unused_component >();
+        }
+
+        world.reset();
+    }
+}
+
+void ecs_tests::instantiate_benchmark()
+{
+    using test_prefab = ecs::prefab< component_2, component_1, unused_component >;
+    ecs::world world;
+
+    QBENCHMARK
+    {
+        for( int i{ 0 }; i < 1000; ++i )
+        {
+            world.instantiate< test_prefab >( std::make_tuple( i ), std::make_tuple(), std::make_tuple() );
+        }
+
+        world.reset();
+    }
+}
+
+void ecs_tests::rw_lock_contention_benchmark_data()
+{
+    QTest::addColumn< QString >( "lock" );
+    QTest::addColumn< int >( "threads_num" );
+    QTest::addColumn< int >( "write_percent" );
+
+    // entity_lock is no_lock unless a lock policy is configured, the counter would race then
+    bool entity_lock_enabled{ !std::is_same< ecs::entity_lock, ecs::no_lock >::value };
+
+    for( const char* lock : { "rw_spinlock", "rw_lock", "entity_lock" } )
+    {
+        if( !entity_lock_enabled && QString{ lock } == "entity_lock" )
+        {
+            continue;
+        }
+
+        for( int threads_num : { 1, 2, 4, 8 } )
+        {
+            for( int write_percent : { 0, 10, 50 } )
+            {
+                QString name{ QString{ "%1, %2 threads, %3% writes" }.arg( lock ).arg( threads_num ).arg( write_percent ) };
+                QTest::newRow( name.toLatin1().constData() ) << QString{ lock } << threads_num << write_percent;
+            }
+        }
+    }
+}
+
+void ecs_tests::rw_lock_contention_benchmark()
+{
+    static constexpr int ops_num{ 20000 };
+
+    QFETCH( QString, lock );
+    QFETCH( int, threads_num );
+    QFETCH( int, write_percent );
+
+    int64_t expected_writes{ int64_t{ threads_num } * ( ops_num / 100 ) * write_percent };
+    int64_t writes{ 0 };
+
+    QBENCHMARK
+    {
+        if( lock == "rw_spinlock" )
+        {
+            writes = run_contention< ecs::rw_spinlock >( threads_num, write_percent, ops_num );
+        }
+        else if( lock == "rw_lock" )
+        {
+            writes = run_contention< ecs::rw_lock >( threads_num, write_percent, ops_num );
+        }
+        else
+        {
+            writes = run_contention< ecs::entity_lock >( threads_num, write_percent, ops_num );
+        }
+    }
+
+    // the writes are serialized
+    QVERIFY( writes == expected_writes );
+}
+
+void ecs_tests::grouped_loop_benchmark_data()
+{
+    QTest::addColumn< bool >( "parallel" );
+
+    QTest::newRow( "for_each_with" ) << false;
+    QTest::newRow( "par_for_each_with" ) << true;
+}
+
+void ecs_tests::grouped_loop_benchmark()
+{
+    static constexpr int entities_num{ 10000 };
+
+    QFETCH( bool, parallel );
+
+    ecs::world world;
+    world.set_workers_num( 4 );
+
+    for( int i{ 0 }; i < entities_num; ++i )
+    {
+        world.create_entity().add_component< component_2 >( i );
+    }
+
+    // some work per entity, like a path search of the tank ai
+    auto work = []( component_2& c )
+    {
+        uint32_t hash{ static_cast< uint32_t >( c.data ) };
+        for( int i{ 0 }; i < 1000; ++i )
+        {
+            hash = hash * 1664525u + 1013904223u;
+        }
+
+        c.data = static_cast< int >( hash & 0xff );
+    };
+
+    scheduled_system looping{ world, [ & ]
+    {
+        if( parallel )
+        {
+            world.par_for_each_with< component_2 >( [ & ]( ecs::entity&, component_2& c ){ work( c ); } );
+        }
+        else
+        {
+            world.for_each_with< component_2 >( [ & ]( ecs::entity&, component_2& c ){ work( c ); return true; } );
+        }
+
+        return true;
+    } };
+
+    scheduled_system other{ world, []{ return true; } };
+    looping.with_writes< component_2 >();
+    other.with_reads< component_1 >();
+
+    world.add_system( looping );
+    world.add_system( other );
+
+    QBENCHMARK
+    {
+        world.tick();
+    }
+
+    world.remove_system( looping );
+    world.remove_system( other );
+}
+
 void ecs_tests::add_components( ecs::entity& e )
 {
     e.add_component< component_1 >();